@@ -0,0 +1,97 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "arena.h"
+
+#define ARENA_CHUNK (64 * 1024)
+#define ARENA_ALIGN 16
+
+struct ArenaChunk {
+	ArenaChunk* next;
+	size_t size;
+	size_t used;
+	char data[];
+};
+
+void arena_init(Arena* a) {
+	memset(a, 0, sizeof(Arena));
+}
+
+/* Place allocation in current chunk, NULL when it does not fit */
+static void* chunk_alloc(Arena* a, size_t size) {
+	ArenaChunk* c = a->cur;
+	uintptr_t p = (uintptr_t) (c->data + c->used);
+	size_t off = ((p + ARENA_ALIGN - 1) & ~(uintptr_t) (ARENA_ALIGN - 1)) - (uintptr_t) c->data;
+
+	if (off + size > c->size) return NULL;
+	c->used = off + size;
+	a->last = off;
+	return c->data + off;
+}
+
+void* arena_alloc(Arena* a, size_t size) {
+	void* p;
+
+	a->allocs++;
+	while (a->cur) {
+		if ((p = chunk_alloc(a, size))) return p;
+		if (! a->cur->next) break;
+
+		/* Chunk kept from before reset */
+		a->cur = a->cur->next;
+		a->cur->used = 0;
+	}
+
+	/* Chunks at least double, so their number stays logarithmic */
+	size_t csize = ARENA_CHUNK;
+	if (a->cur && 2 * a->cur->size > csize) csize = 2 * a->cur->size;
+	if (csize < size + ARENA_ALIGN) csize = size + ARENA_ALIGN;
+
+	ArenaChunk* c = malloc(sizeof(ArenaChunk) + csize);
+	c->next = NULL;
+	c->size = csize;
+	c->used = 0;
+	a->heap_allocs++;
+
+	if (a->cur) a->cur->next = c;
+	else a->head = c;
+	a->cur = c;
+	return chunk_alloc(a, size);
+}
+
+void* arena_calloc(Arena* a, size_t size) {
+	void* p = arena_alloc(a, size);
+	memset(p, 0, size);
+	return p;
+}
+
+/* Last allocation grows in place when chunk has room */
+void* arena_realloc(Arena* a, void* p, size_t old_size, size_t size) {
+	if (p && a->cur && (char*) p == a->cur->data + a->last &&
+	    a->last + size <= a->cur->size) {
+		a->cur->used = a->last + size;
+		return p;
+	}
+
+	void* n = arena_alloc(a, size);
+	if (p) memcpy(n, p, old_size < size ? old_size : size);
+	return n;
+}
+
+void arena_reset(Arena* a) {
+	a->cur = a->head;
+	if (a->cur) a->cur->used = 0;
+	a->allocs = 0;
+	a->heap_allocs = 0;
+}
+
+void arena_free(Arena* a) {
+	ArenaChunk* c = a->head;
+	while (c) {
+		ArenaChunk* next = c->next;
+		free(c);
+		c = next;
+	}
+	arena_init(a);
+}
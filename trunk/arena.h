@@ -0,0 +1,25 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+typedef struct ArenaChunk ArenaChunk;
+
+/* Bump allocator over chained chunks, freed or reset as a whole.
+ * Reset keeps the chunks, so same sized work does not touch heap */
+typedef struct {
+	ArenaChunk* head;
+	ArenaChunk* cur;
+	size_t last; /* offset of last allocation in cur */
+	unsigned int allocs;      /* allocations since reset */
+	unsigned int heap_allocs; /* chunks taken from heap since reset */
+} Arena;
+
+void arena_init(Arena* a);
+void* arena_alloc(Arena* a, size_t size);
+void* arena_calloc(Arena* a, size_t size);
+void* arena_realloc(Arena* a, void* p, size_t old_size, size_t size);
+void arena_reset(Arena* a);
+void arena_free(Arena* a);
+
+#endif /* ARENA_H */
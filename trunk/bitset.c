@@ -0,0 +1,57 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "bitset.h"
+
+#define WORD_BITS (8 * sizeof(unsigned long))
+#define WORDS(n) (((n) + WORD_BITS - 1) / WORD_BITS)
+
+/* Resize and clear; storage only grows */
+void bitset_resize(Bitset* bs, unsigned int size) {
+	if ( WORDS(size) + 1 > bs->capacity || ! bs->bits ) {
+		bs->capacity = WORDS(size) + 1;
+		bs->bits = realloc(bs->bits, bs->capacity * sizeof(unsigned long));
+	}
+
+	bs->size = size;
+	bitset_clear_all(bs);
+}
+
+void bitset_free(Bitset* bs) {
+	free(bs->bits);
+	bs->bits = NULL;
+	bs->size = 0;
+	bs->capacity = 0;
+}
+
+void bitset_clear_all(Bitset* bs) {
+	if (! bs->bits) return;
+	memset(bs->bits, 0, WORDS(bs->size) * sizeof(unsigned long));
+}
+
+void bitset_set(Bitset* bs, unsigned int n, bool value) {
+	if (n >= bs->size) return;
+
+	unsigned long mask = 1UL << (n % WORD_BITS);
+	if (value)
+		bs->bits[n / WORD_BITS] |= mask;
+	else
+		bs->bits[n / WORD_BITS] &= ~mask;
+}
+
+void bitset_toggle(Bitset* bs, unsigned int n) {
+	if (n >= bs->size) return;
+	bs->bits[n / WORD_BITS] ^= 1UL << (n % WORD_BITS);
+}
+
+bool bitset_get(const Bitset* bs, unsigned int n) {
+	if (n >= bs->size) return false;
+	return bs->bits[n / WORD_BITS] & (1UL << (n % WORD_BITS));
+}
+
+unsigned int bitset_count(const Bitset* bs) {
+	unsigned int i, ret = 0;
+	for (i = 0; i < WORDS(bs->size); i++)
+		ret += __builtin_popcountl(bs->bits[i]);
+	return ret;
+}
@@ -0,0 +1,20 @@
+#ifndef BITSET_H
+#define BITSET_H
+
+#include <stdbool.h>
+
+typedef struct {
+	unsigned long* bits;
+	unsigned int size;
+	unsigned int capacity; /* in words */
+} Bitset;
+
+void bitset_resize(Bitset* bs, unsigned int size);
+void bitset_free(Bitset* bs);
+void bitset_clear_all(Bitset* bs);
+void bitset_set(Bitset* bs, unsigned int n, bool value);
+void bitset_toggle(Bitset* bs, unsigned int n);
+bool bitset_get(const Bitset* bs, unsigned int n);
+unsigned int bitset_count(const Bitset* bs);
+
+#endif /* BITSET_H */
@@ -0,0 +1,246 @@
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <jack/midiport.h>
+
+#include "meter.h"
+
+#define METER_LANES 8
+#define METER_WAIT 20 /* times 5 msecs for process cycles to pass */
+
+void meter_init(Meters* m) {
+	unsigned int i;
+
+	memset(m, 0, sizeof(Meters));
+	atomic_init(&m->channels, 0);
+	atomic_init(&m->cycles, 0);
+	atomic_init(&m->count, 0);
+	for (i = 0; i < METER_SLOTS; i++)
+		atomic_init(&m->blocks[i].seq, 0);
+	for (i = 0; i < METER_CHANNELS; i++)
+		atomic_init(&m->events[i], 0);
+}
+
+/* Peak and sum of squares of buffer. Lanes are independent
+ * accumulators, so compiler can turn main loop into vector code */
+static void meter_kernel(const float* restrict buf, jack_nframes_t n, float* peak, float* sum) {
+	float p[METER_LANES] = { 0 };
+	float s[METER_LANES] = { 0 };
+	jack_nframes_t i, k;
+
+	for (i = 0; i + METER_LANES <= n; i += METER_LANES) {
+		for (k = 0; k < METER_LANES; k++) {
+			float v = buf[i + k];
+			float a = fabsf(v);
+			p[k] = a > p[k] ? a : p[k];
+			s[k] += v * v;
+		}
+	}
+	for (; i < n; i++) {
+		float a = fabsf(buf[i]);
+		p[0] = a > p[0] ? a : p[0];
+		s[0] += buf[i] * buf[i];
+	}
+
+	for (k = 0; k < METER_LANES; k++) {
+		if (p[k] > *peak) *peak = p[k];
+		*sum += s[k];
+	}
+}
+
+static void meter_publish(Meters* m, unsigned int channels) {
+	unsigned int i, n = atomic_load_explicit(&m->count, memory_order_relaxed);
+	MeterBlock* b = m->blocks + (n & (METER_SLOTS - 1));
+
+	atomic_store_explicit(&b->seq, 0, memory_order_relaxed);
+	atomic_thread_fence(memory_order_release);
+	for (i = 0; i < channels; i++) {
+		b->peak[i] = m->acc_peak[i];
+		b->rms[i] = sqrtf(m->acc_sum[i] / m->frames);
+		m->acc_peak[i] = m->acc_sum[i] = 0;
+	}
+	atomic_store_explicit(&b->seq, n + 1, memory_order_release);
+	atomic_store_explicit(&m->count, n + 1, memory_order_release);
+	m->frames = 0;
+}
+
+/* Process thread: no locks, no allocations */
+void meter_process(Meters* m, jack_nframes_t nframes) {
+	unsigned int i, channels = atomic_load_explicit(&m->channels, memory_order_acquire);
+
+	if (channels) {
+		for (i = 0; i < channels; i++) {
+			void* buf = jack_port_get_buffer(m->ports[i], nframes);
+			if (m->midi[i]) {
+				atomic_fetch_add_explicit(m->events + i, jack_midi_get_event_count(buf),
+					memory_order_relaxed);
+			} else {
+				meter_kernel(buf, nframes, m->acc_peak + i, m->acc_sum + i);
+			}
+		}
+		m->frames += nframes;
+		if (m->frames >= m->block_frames)
+			meter_publish(m, channels);
+	}
+
+	/* Cycle is over, it does not touch ports any more */
+	atomic_fetch_add_explicit(&m->cycles, 1, memory_order_release);
+}
+
+/* Take ports away from process thread: cycle which may have seen them
+ * ends before next one is counted. Server not running cycles does not
+ * use them either, so waiting is bounded */
+static void meter_quiesce(Meters* m) {
+	struct timespec tick = { 0, 5000000L };
+	unsigned int i, c0;
+
+	atomic_store_explicit(&m->channels, 0, memory_order_release);
+	c0 = atomic_load_explicit(&m->cycles, memory_order_acquire);
+	for (i = 0; i < METER_WAIT; i++) {
+		if (atomic_load_explicit(&m->cycles, memory_order_acquire) - c0 >= 2)
+			break;
+		nanosleep(&tick, NULL);
+	}
+}
+
+/* Meter given audio or MIDI ports, monitor inputs of their type are
+ * registered as needed and kept until stop.
+ * Returns false when nothing is metered */
+bool meter_start(Meters* m, jack_client_t* client, jack_port_t** sources, unsigned int count) {
+	unsigned int i;
+	char name[32];
+
+	meter_quiesce(m);
+	for (i = 0; i < m->registered; i++)
+		jack_port_disconnect(client, m->ports[i]);
+
+	if (count > METER_CHANNELS) count = METER_CHANNELS;
+	for (i = 0; i < count; i++) {
+		bool midi = strcmp(jack_port_type(sources[i]), JACK_DEFAULT_MIDI_TYPE) == 0;
+		if (i < m->registered) {
+			if (m->midi[i] == midi) continue;
+			jack_port_unregister(client, m->ports[i]);
+		}
+
+		snprintf(name, sizeof(name), "meter_%u", i + 1);
+		jack_port_t* p = jack_port_register(client, name,
+			midi ? JACK_DEFAULT_MIDI_TYPE : JACK_DEFAULT_AUDIO_TYPE, JackPortIsInput, 0);
+		if (! p) {
+			while (m->registered > i + 1)
+				jack_port_unregister(client, m->ports[--m->registered]);
+			m->registered = i;
+			break;
+		}
+		m->ports[i] = p;
+		m->midi[i] = midi;
+		if (i == m->registered) m->registered++;
+	}
+	if (count > m->registered) count = m->registered;
+
+	for (i = 0; i < count; i++) {
+		m->sources[i] = sources[i];
+		jack_connect(client, jack_port_name(sources[i]), jack_port_name(m->ports[i]));
+	}
+
+	/* Process thread is off channels, its state can be reset */
+	m->block_frames = jack_get_sample_rate(client) / METER_RATE;
+	m->frames = 0;
+	memset(m->acc_peak, 0, sizeof(m->acc_peak));
+	memset(m->acc_sum, 0, sizeof(m->acc_sum));
+	memset(m->peak, 0, sizeof(m->peak));
+	memset(m->rms, 0, sizeof(m->rms));
+	m->read = atomic_load_explicit(&m->count, memory_order_acquire);
+	for (i = 0; i < METER_CHANNELS; i++)
+		atomic_store_explicit(m->events + i, 0, memory_order_relaxed);
+	memset(m->events_last, 0, sizeof(m->events_last));
+	memset(m->events_base, 0, sizeof(m->events_base));
+	memset(m->active, 0, sizeof(m->active));
+	memset(m->rate, 0, sizeof(m->rate));
+	m->rate_time = m->now = jack_get_time();
+
+	atomic_store_explicit(&m->channels, count, memory_order_release);
+	return count > 0;
+}
+
+void meter_stop(Meters* m, jack_client_t* client) {
+	unsigned int i;
+
+	meter_quiesce(m);
+	for (i = 0; i < m->registered; i++)
+		jack_port_unregister(client, m->ports[i]);
+	m->registered = 0;
+}
+
+/* Follow MIDI event counters: activity and events per second */
+static bool meter_read_events(Meters* m, unsigned int channels) {
+	bool window = m->now - m->rate_time >= METER_RATE_TIME;
+	bool ret = window;
+	unsigned int i;
+
+	for (i = 0; i < channels; i++) {
+		if (! m->midi[i]) continue;
+
+		unsigned int e = atomic_load_explicit(m->events + i, memory_order_relaxed);
+		if (e != m->events_last[i]) {
+			m->events_last[i] = e;
+			m->active[i] = m->now;
+			ret = true;
+		}
+		if (window) {
+			m->rate[i] = (e - m->events_base[i]) * 1e6f / (m->now - m->rate_time);
+			m->events_base[i] = e;
+		}
+	}
+	if (window) m->rate_time = m->now;
+	return ret;
+}
+
+/* Fold blocks published since last read into levels and follow
+ * MIDI counters, false when there is nothing new */
+bool meter_read(Meters* m) {
+	unsigned int count = atomic_load_explicit(&m->count, memory_order_acquire);
+	unsigned int channels = atomic_load_explicit(&m->channels, memory_order_relaxed);
+	float peak[METER_CHANNELS], rms[METER_CHANNELS];
+	unsigned int i;
+
+	m->now = jack_get_time();
+	bool events = meter_read_events(m, channels);
+	if (m->read == count) return events;
+	if (count - m->read > METER_SLOTS / 2)
+		m->read = count - METER_SLOTS / 2; /* rest is being overwritten */
+
+	memset(m->peak, 0, sizeof(m->peak));
+	memset(m->rms, 0, sizeof(m->rms));
+	for (; m->read != count; m->read++) {
+		MeterBlock* b = m->blocks + (m->read & (METER_SLOTS - 1));
+
+		if (atomic_load_explicit(&b->seq, memory_order_acquire) != m->read + 1)
+			continue;
+		memcpy(peak, b->peak, channels * sizeof(float));
+		memcpy(rms, b->rms, channels * sizeof(float));
+		atomic_thread_fence(memory_order_acquire);
+		if (atomic_load_explicit(&b->seq, memory_order_relaxed) != m->read + 1)
+			continue;
+
+		for (i = 0; i < channels; i++) {
+			if (peak[i] > m->peak[i]) m->peak[i] = peak[i];
+			if (rms[i] > m->rms[i]) m->rms[i] = rms[i];
+		}
+	}
+	return true;
+}
+
+/* MIDI channel had events lately */
+bool meter_led(Meters* m, int channel) {
+	return m->active[channel] && m->now - m->active[channel] < METER_LED_HOLD;
+}
+
+/* Channel metering given port, -1 if it is not metered */
+int meter_channel(Meters* m, jack_port_t* source) {
+	unsigned int i, channels = atomic_load_explicit(&m->channels, memory_order_relaxed);
+
+	for (i = 0; i < channels; i++)
+		if (m->sources[i] == source) return i;
+	return -1;
+}
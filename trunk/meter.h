@@ -0,0 +1,63 @@
+#ifndef METER_H
+#define METER_H
+
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <jack/jack.h>
+
+#define METER_CHANNELS 64
+#define METER_SLOTS 16   /* power of two */
+#define METER_RATE 50    /* blocks per second */
+#define METER_LED_HOLD 150000   /* usecs MIDI activity stays lit */
+#define METER_RATE_TIME 1000000 /* usecs over which events per second are counted */
+
+/* Levels of one block of periods */
+typedef struct {
+	float peak[METER_CHANNELS];
+	float rms[METER_CHANNELS];
+	atomic_uint seq; /* block number + 1, 0 while written */
+} MeterBlock;
+
+/* Own monitor inputs connected to metered ports. Process thread sums
+ * audio periods into blocks and publishes them in ring, it never waits:
+ * blocks UI did not read in time are overwritten. MIDI channels count
+ * events instead, counters are read by UI directly */
+typedef struct {
+	jack_port_t* ports[METER_CHANNELS];   /* registered on demand */
+	jack_port_t* sources[METER_CHANNELS]; /* metered ports */
+	bool midi[METER_CHANNELS];            /* type of monitor input */
+	unsigned int registered;
+	atomic_uint channels; /* in use, 0 while UI changes setup */
+	atomic_uint cycles;   /* process cycles seen */
+
+	/* Process thread only */
+	jack_nframes_t block_frames;
+	jack_nframes_t frames;
+	float acc_peak[METER_CHANNELS];
+	float acc_sum[METER_CHANNELS];
+
+	atomic_uint count; /* published blocks */
+	MeterBlock blocks[METER_SLOTS];
+	atomic_uint events[METER_CHANNELS]; /* MIDI events since start */
+
+	/* UI only: levels of blocks read last, MIDI activity */
+	unsigned int read;
+	float peak[METER_CHANNELS];
+	float rms[METER_CHANNELS];
+	unsigned int events_last[METER_CHANNELS];
+	unsigned int events_base[METER_CHANNELS]; /* at start of rate window */
+	jack_time_t active[METER_CHANNELS];       /* last change of counter */
+	jack_time_t rate_time;
+	jack_time_t now;
+	float rate[METER_CHANNELS]; /* events per second */
+} Meters;
+
+void meter_init(Meters* m);
+bool meter_start(Meters* m, jack_client_t* client, jack_port_t** sources, unsigned int count);
+void meter_stop(Meters* m, jack_client_t* client);
+void meter_process(Meters* m, jack_nframes_t nframes);
+bool meter_read(Meters* m);
+int meter_channel(Meters* m, jack_port_t* source);
+bool meter_led(Meters* m, int channel);
+
+#endif /* METER_H */
@@ -0,0 +1,134 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "monitor.h"
+
+void xrun_init(XrunLog* log) {
+	unsigned int i;
+	atomic_init(&log->count, 0);
+	for (i = 0; i < XRUN_HISTORY; i++)
+		atomic_init(&log->slots[i].seq, 0);
+}
+
+/* Single writer: slot is invalidated, filled, then published */
+void xrun_record(XrunLog* log, jack_time_t time, float delay) {
+	unsigned int n = atomic_load_explicit(&log->count, memory_order_relaxed);
+	XrunSlot* s = log->slots + (n & (XRUN_HISTORY - 1));
+
+	atomic_store_explicit(&s->seq, 0, memory_order_relaxed);
+	atomic_thread_fence(memory_order_release);
+	s->x.time = time;
+	s->x.delay = delay;
+	atomic_store_explicit(&s->seq, n + 1, memory_order_release);
+	atomic_store_explicit(&log->count, n + 1, memory_order_release);
+}
+
+unsigned int xrun_count(XrunLog* log) {
+	return atomic_load_explicit(&log->count, memory_order_acquire);
+}
+
+/* Copy of record n, false when it is not written yet or overwritten */
+bool xrun_get(XrunLog* log, unsigned int n, Xrun* out) {
+	XrunSlot* s = log->slots + (n & (XRUN_HISTORY - 1));
+
+	if (atomic_load_explicit(&s->seq, memory_order_acquire) != n + 1)
+		return false;
+	*out = s->x;
+	atomic_thread_fence(memory_order_acquire);
+	return atomic_load_explicit(&s->seq, memory_order_relaxed) == n + 1;
+}
+
+/* Xruns since given time, as far as history reaches */
+unsigned int xrun_since(XrunLog* log, jack_time_t since) {
+	unsigned int n = xrun_count(log);
+	unsigned int ret = 0;
+	Xrun x;
+
+	while (n-- > 0 && xrun_get(log, n, &x) && x.time >= since)
+		ret++;
+	return ret;
+}
+
+void dsp_init(DspLog* log) {
+	unsigned int i;
+	atomic_init(&log->count, 0);
+	for (i = 0; i < DSP_HISTORY; i++)
+		atomic_init(&log->samples[i], 0);
+}
+
+void dsp_record(DspLog* log, float load) {
+	unsigned int n = atomic_load_explicit(&log->count, memory_order_relaxed);
+
+	if (load < 0) load = 0;
+	if (load > 100) load = 100;
+	atomic_store_explicit(&log->samples[n & (DSP_HISTORY - 1)],
+		(unsigned short) (load * 100), memory_order_relaxed);
+	atomic_store_explicit(&log->count, n + 1, memory_order_release);
+}
+
+/* Latest sample, so UI does not ask server every frame */
+float dsp_last(DspLog* log) {
+	unsigned int n = atomic_load_explicit(&log->count, memory_order_acquire);
+	if (n == 0) return 0;
+	return atomic_load_explicit(&log->samples[(n - 1) & (DSP_HISTORY - 1)],
+		memory_order_relaxed) / 100.0f;
+}
+
+/* Copy of up to n latest samples oldest first, returns their count */
+unsigned int dsp_window(DspLog* log, unsigned short* out, unsigned int n) {
+	unsigned int count = atomic_load_explicit(&log->count, memory_order_acquire);
+	unsigned int i;
+
+	if (n > count) n = count;
+	if (n > DSP_HISTORY / 2) n = DSP_HISTORY / 2; /* keep off slots being written */
+	for (i = 0; i < n; i++)
+		out[i] = atomic_load_explicit(&log->samples[(count - n + i) & (DSP_HISTORY - 1)],
+			memory_order_relaxed);
+	return n;
+}
+
+static int cmp_sample(const void* a, const void* b) {
+	return *(const unsigned short*) a - *(const unsigned short*) b;
+}
+
+/* Percentiles of samples, which get sorted */
+void dsp_stats(unsigned short* samples, unsigned int n, DspStats* st) {
+	if (n == 0) {
+		st->p50 = st->p99 = st->max = 0;
+		return;
+	}
+	qsort(samples, n, sizeof(unsigned short), cmp_sample);
+	st->p50 = samples[(n - 1) / 2] / 100.0f;
+	st->p99 = samples[(n - 1) * 99 / 100] / 100.0f;
+	st->max = samples[n - 1] / 100.0f;
+}
+
+void change_init(ChangeLog* log) {
+	memset(log, 0, sizeof(ChangeLog));
+}
+
+/* Next record, caller fills in text */
+Change* change_add(ChangeLog* log, jack_time_t time, unsigned long generation, bool own) {
+	Change* c = log->items + (log->count++ & (CHANGE_HISTORY - 1));
+	c->time = time;
+	c->generation = generation;
+	c->own = own;
+	c->text[0] = '\0';
+	return c;
+}
+
+Change* change_get(ChangeLog* log, unsigned int n) {
+	if (n >= log->count || n + CHANGE_HISTORY < log->count)
+		return NULL;
+	return log->items + (n & (CHANGE_HISTORY - 1));
+}
+
+/* Latest change not after given time */
+Change* change_before(ChangeLog* log, jack_time_t time) {
+	unsigned int n = log->count;
+	Change* c;
+
+	while (n-- > 0 && (c = change_get(log, n)))
+		if (c->time <= time) return c;
+	return NULL;
+}
@@ -0,0 +1,75 @@
+#ifndef MONITOR_H
+#define MONITOR_H
+
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <jack/jack.h>
+
+#define XRUN_HISTORY 64   /* power of two */
+#define CHANGE_HISTORY 64 /* power of two */
+#define CHANGE_TEXT 96
+#define DSP_HISTORY 2048  /* power of two */
+#define DSP_PERIOD 100    /* msecs between load samples */
+
+typedef struct {
+	jack_time_t time;
+	float delay; /* usecs, as reported by server */
+} Xrun;
+
+typedef struct {
+	Xrun x;
+	atomic_uint seq; /* record number + 1, 0 while written */
+} XrunSlot;
+
+/* Written by Jack notification thread only, read by UI without locks.
+ * Old records are overwritten, seq tells reader a slot was reused */
+typedef struct {
+	atomic_uint count; /* total since start */
+	XrunSlot slots[XRUN_HISTORY];
+} XrunLog;
+
+/* Graph change made or observed by UI */
+typedef struct {
+	jack_time_t time;
+	unsigned long generation;
+	bool own;
+	char text[CHANGE_TEXT];
+} Change;
+
+/* UI thread only */
+typedef struct {
+	unsigned int count;
+	Change items[CHANGE_HISTORY];
+} ChangeLog;
+
+/* Load samples in hundredths of percent, written by sampler thread
+ * only. Old samples are overwritten, each one is read whole */
+typedef struct {
+	atomic_uint count;
+	atomic_ushort samples[DSP_HISTORY];
+} DspLog;
+
+typedef struct {
+	float p50;
+	float p99;
+	float max;
+} DspStats;
+
+void xrun_init(XrunLog* log);
+void xrun_record(XrunLog* log, jack_time_t time, float delay);
+unsigned int xrun_count(XrunLog* log);
+bool xrun_get(XrunLog* log, unsigned int n, Xrun* out);
+unsigned int xrun_since(XrunLog* log, jack_time_t since);
+
+void dsp_init(DspLog* log);
+void dsp_record(DspLog* log, float load);
+float dsp_last(DspLog* log);
+unsigned int dsp_window(DspLog* log, unsigned short* out, unsigned int n);
+void dsp_stats(unsigned short* samples, unsigned int n, DspStats* st);
+
+void change_init(ChangeLog* log);
+Change* change_add(ChangeLog* log, jack_time_t time, unsigned long generation, bool own);
+Change* change_get(ChangeLog* log, unsigned int n);
+Change* change_before(ChangeLog* log, jack_time_t time);
+
+#endif /* MONITOR_H */
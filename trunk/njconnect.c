@@ -23,23 +23,38 @@
  *
  *****************************************************************************/
 
+#include <stdlib.h>
 #include <string.h>
+#include <math.h>
+#include <time.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
 #include <ncurses.h>
 #include <jack/jack.h>
-#include <jack/jslist.h>
 #include <stdbool.h>
 
-/* Functions forgotten by Jack-Devs */
-#include "jslist_extra.h"
-
 #include "port_connection.h"
 #include "window.h"
+#include "monitor.h"
+#include "meter.h"
+#include "perf.h"
 
 #define APPNAME "njconnect"
 #define VERSION "1.6"
 
 #define KEY_TAB '\t'
 #define KEY_SPACE ' '
+#define KEY_TIMEOUT 1000
+#define KEY_TIMEOUT_BUSY 20 /* poll while meters run */
+#define EVENTS_SIZE 256 /* power of two */
+#define XRUN_RATE_WINDOW 60000000 /* usecs, status shows xruns per minute */
+#define XRUN_CAUSE_WINDOW 2000000 /* usecs, change this close may be the cause */
+#define SPARK_LEVELS " _.-~=*#"
+#define SPARK_MAX 60
+#define METER_FLOOR -60.0f /* dB at empty bar */
 
 #define WOUT_X 0
 #define WOUT_Y 0
@@ -61,18 +76,40 @@
 #define WSTAT_W cols
 #define WSTAT_H 0
 
+#define WPERF_W 46
+#define WPERF_H (PERF_TIMERS + 5)
+
 #define MSG_OUT(format, arg...) printf(format "\n", ## arg)
 #define ERR_OUT(format, arg...) ( endwin(), fprintf(stderr, format "\n", ## arg), refresh() )
 
 // Common Strings
 const char* CON_NAME_A          = "Audio Connections";
 const char* CON_NAME_M          = "MIDI Connections";
+const char* CON_NAME_ALL        = "All Connections";
 const char* ERR_CONNECT         = "Connection failed";
 const char* ERR_DISCONNECT      = "Disconnection failed";
+const char* CONNECT_CANCELLED   = "Connection cancelled";
+const char* ERR_METER           = "No audio or MIDI output port to meter";
 const char* GRAPH_CHANGED       = "Graph changed";
 const char* SAMPLE_RATE_CHANGED = "Sample rate changed";
 const char* BUFFER_SIZE_CHANGED = "Buffer size changed";
+const char* LATENCY_SHOWN       = "Latency in frames: port / worst path through port";
 const char* DEFAULT_STATUS      = "->> Press SHIFT+H or ? for help <<-";
+const char* ELIDED_CLIENT       = "~:";
+
+/* DSP load history windows in seconds, "L" cycles them and off */
+#define LOAD_WINDOWS_MAX 8
+#define LOAD_WINDOW_LIMIT (DSP_HISTORY / 2 * DSP_PERIOD / 1000) /* seconds kept */
+const char* LOAD_WINDOWS_DEFAULT = "10,60";
+
+/* Port change delivered by Jack thread, keyed by port ids */
+enum EventType { EV_PORT_REG, EV_PORT_UNREG, EV_CONNECT, EV_DISCONNECT };
+typedef struct {
+	enum EventType type;
+	jack_port_id_t a;
+	jack_port_id_t b;
+	unsigned long long time; /* arrival, while timers run */
+} PortEvent;
 
 typedef struct {
 	jack_client_t* client;
@@ -80,6 +117,12 @@ typedef struct {
 	jack_nframes_t buffer_size;
 	bool rt;
 	bool want_refresh;
+	bool show_debug;
+	WINDOW* perf_window; /* timers of debug overlay */
+	bool show_latency;
+	unsigned short load_windows[LOAD_WINDOWS_MAX + 1]; /* 0 first, hides it */
+	unsigned short load_window_count;
+	unsigned short load_window; /* index in load_windows */
 	const char* err_msg;
 
 	/* Windows */
@@ -89,6 +132,59 @@ typedef struct {
 	WINDOW* grid_window;
 	bool grid_redraw;
 	bool need_mark;
+
+	/* Model: generation read by UI, holds one reference */
+	Graph* graph;
+	unsigned short ports_type;
+	char con_name[64];
+	char diff_msg[96];
+	unsigned int update_allocs;
+	unsigned int update_heap_allocs;
+	unsigned int update_jack_calls;
+	atomic_ulong generation;
+
+	/* Full rebuilds run in builder thread and are handed over in
+	 * pending slot: whoever takes generation out of it owns it */
+	_Atomic(Graph*) pending;
+	pthread_t builder;
+	pthread_mutex_t build_lock;
+	pthread_cond_t build_cond;
+	bool build_requested;
+	bool building;
+	bool quit;
+	Arena build_scratch; /* builder temporaries, kept between builds */
+	GraphDiff diff;      /* storage reused by every diff */
+
+	/* Single producer (Jack thread), single consumer (main loop) */
+	PortEvent events[EVENTS_SIZE];
+	jack_port_id_t run_ids[EVENTS_SIZE]; /* registrations or removals applied together */
+	atomic_uint ev_head;
+	atomic_uint ev_tail;
+	atomic_bool ev_resync; /* events lost or not expressible */
+	unsigned long long ev_time; /* oldest event not on screen yet */
+	atomic_bool latency_changed;
+	int wake[2];          /* self-pipe, main loop polls it next to keys */
+	atomic_bool wake_sent; /* byte in pipe not read yet */
+
+	/* Connected ports highlighting, bit per port of generation */
+	Bitset marks;
+	Port* marked_out;
+	Port* marked_in;
+	bool tracing; /* whole flow instead of direct peers */
+	Trace trace;
+
+	/* Dropouts against graph changes made or seen */
+	XrunLog xruns;
+	ChangeLog changes;
+
+	/* DSP load sampled on timer, UI reads cached samples */
+	DspLog dsp;
+	pthread_t sampler;
+	atomic_bool sampling;
+
+	/* Levels of metered output ports */
+	Meters meters;
+	bool metering;
 } NJ;
 
 void suppress_jack_log(const char* msg) {
@@ -96,16 +192,21 @@ void suppress_jack_log(const char* msg) {
 }
 
 unsigned short
-choose_color( Window* W, JSList* node, bool item_selected ) {
+choose_color( Window* W, Graph* g, Bitset* marks, unsigned int pos, bool item_selected ) {
 	bool item_mark = false;
 	if ( W->type == WIN_PORTS ) {
-		Port* p = node->data;
-		if ( p->mark )
+		Port* p = w_get_item(W, pos);
+		if ( bitset_get(marks, p - g->ports) )
 			item_mark = true;
+	} else if ( connection_looped(g, w_get_item(W, pos)) ) {
+		item_mark = true; /* part of feedback loop */
 	}
 
-	if ( ! item_selected )
+	if ( ! item_selected ) {
+		if ( w_is_selected(W, pos) )
+			return 10;
 		return item_mark ? 8 : 1;
+	}
 
 	if ( W->selected )
 		return 3;
@@ -114,33 +215,110 @@ choose_color( Window* W, JSList* node, bool item_selected ) {
 	return item_mark ? 9 : 2;
 }
 
-void w_draw_list(Window* W) {
-	unsigned short rows, cols;
-	getmaxyx(W->window_ptr, rows, cols);
+/* Draw name padded to window name column, when name does not fit
+ * client prefix is elided */
+void w_draw_name( Window* W, Graph* g, Port* p, bool align_right ) {
+	WINDOW* w = W->window_ptr;
+	int client_len = g->clients[p->client].name_len;
+	int len = port_name_len(g, p);
+	int width = W->name_width;
+	bool elide = ( len > width && width > 2 );
+
+	if ( elide ) {
+		client_len = -1; /* no client, no colon */
+		len = p->name_len;
+		width -= 2;
+	}
+	if ( len > width ) len = width;
+
+	if ( align_right ) waddnstr(w, W->blank, width - len);
+	if ( elide ) {
+		waddnstr(w, ELIDED_CLIENT, 2);
+	} else {
+		waddnstr(w, port_client_name(g, p), client_len < len ? client_len : len);
+		if ( client_len < len ) waddnstr(w, ":", 1);
+	}
+	if ( len > client_len + 1 )
+		waddnstr(w, port_name(g, p), len - client_len - 1);
+	if ( ! align_right ) waddnstr(w, W->blank, width - len);
+}
+
+void w_draw_tag( Window* W, Graph* g, unsigned short type ) {
+	char tag[W_TAG_WIDTH] = { port_type_tag(g, type), ' ' };
+	waddnstr(W->window_ptr, tag, W_TAG_WIDTH);
+}
+
+/* Audio: RMS as bar, peak as marker, over METER_FLOOR .. 0 dB.
+ * MIDI: activity LED and events per second */
+unsigned int meter_cells( float level ) {
+	if ( level <= 0 ) return 0;
+	float db = 20 * log10f(level);
+	if ( db <= METER_FLOOR ) return 0;
+	if ( db >= 0 ) return W_METER_BAR;
+	return (db - METER_FLOOR) * W_METER_BAR / -METER_FLOOR;
+}
+
+void w_draw_meter( Window* W, Meters* m, Port* p ) {
+	char bar[W_METER_WIDTH];
+	int ch = meter_channel( m, p->jport );
+
+	memset(bar, ' ', W_METER_WIDTH);
+	if ( ch >= 0 && m->midi[ch] ) {
+		char midi[W_METER_WIDTH + 16];
+		snprintf(midi, sizeof(midi), " [%c] %6.0f/s", meter_led(m, ch) ? '*' : ' ', m->rate[ch]);
+		memcpy(bar, midi, W_METER_WIDTH);
+	} else if ( ch >= 0 ) {
+		unsigned int rms = meter_cells( m->rms[ch] );
+		unsigned int peak = meter_cells( m->peak[ch] );
+		bar[1] = '[';
+		memset(bar + 2, '=', rms);
+		if ( peak > rms ) bar[1 + peak] = m->peak[ch] >= 1.0f ? '!' : '|';
+		bar[W_METER_WIDTH - 1] = ']';
+	}
+	waddnstr(W->window_ptr, bar, W_METER_WIDTH);
+}
+
+int latency_label( char* buf, size_t size, Port* p ) {
+	return snprintf( buf, size, " %u/%u", p->latency, p->path );
+}
+
+void w_draw_latency( Window* W, Port* p ) {
+	char buf[32];
+	int len = latency_label( buf, sizeof(buf), p );
+
+	if ( len < W_LAT_WIDTH ) waddnstr(W->window_ptr, W->blank, W_LAT_WIDTH - len);
+	waddnstr(W->window_ptr, buf, W_LAT_WIDTH);
+}
+
+void w_draw_list(Window* W, Graph* g, Bitset* marks, Meters* meters) {
+	unsigned short rows = getmaxy(W->window_ptr);
 
-	short offset = W->index + 3 - rows; // first displayed index
+	long offset = (long) W->index + 3 - rows; // first displayed index
 	if(offset < 0) offset = 0;
 
-	unsigned short row = 1, col = 1;
-	JSList* node;
-	for ( node=jack_slist_nth(W->list,offset); node; node=jack_slist_next(node) ) {
-		char fmt[40];
-		bool item_selected = ( row == W->index - offset + 1 );
+	unsigned int row = 1, col = 1, pos;
+	for ( pos=offset; pos < W->count && row < rows - 1; pos++ ) {
+		bool item_selected = ( pos == W->index );
 
-		unsigned short color = choose_color( W, node, item_selected );
+		unsigned short color = choose_color( W, g, marks, pos, item_selected );
 		wattron(W->window_ptr, COLOR_PAIR(color));
 
 		switch( W->type ) {
 			case WIN_PORTS:;
-				Port* p = node->data;
-				snprintf(fmt, sizeof(fmt), "%%-%d.%ds", cols - 2, cols - 2);
-				mvwprintw(W->window_ptr, row, col, fmt, p->name);
+				Port* p = w_get_item(W, pos);
+				wmove(W->window_ptr, row, col);
+				if ( W->tagged ) w_draw_tag(W, g, p->type);
+				w_draw_name(W, g, p, false);
+				if ( W->latency ) w_draw_latency(W, p);
+				if ( W->metered ) w_draw_meter(W, meters, p);
 				break;
 			case WIN_CONNECTIONS:;
-				Connection* c = node->data;
-				snprintf(fmt, sizeof(fmt), "%%%d.%ds -> %%-%d.%ds",
-					cols/2 - 3, cols/2 - 3, cols/2 - 3, cols/2 - 3);
-				mvwprintw(W->window_ptr, row, col, fmt, c->out->name, c->in->name);
+				Connection* c = w_get_item(W, pos);
+				wmove(W->window_ptr, row, col);
+				if ( W->tagged ) w_draw_tag(W, g, c->type);
+				w_draw_name(W, g, c->out, true);
+				waddstr(W->window_ptr, " -> ");
+				w_draw_name(W, g, c->in, false);
 				break;
 		}
 		wattroff(W->window_ptr, COLOR_PAIR(color));
@@ -149,8 +327,8 @@ void w_draw_list(Window* W) {
 	}
 }
 
-void w_draw(Window* W) {
-	w_draw_list(W);
+void w_draw(Window* W, Graph* g, Bitset* marks, Meters* meters) {
+	w_draw_list(W, g, marks, meters);
 	wclrtobot(W->window_ptr);
 	w_draw_border(W);
 	wrefresh(W->window_ptr);
@@ -158,24 +336,119 @@ void w_draw(Window* W) {
 
 Port*
 w_get_selected_port(Window* W) {
-	JSList* list = jack_slist_nth(W->list, W->index);
-	if (!list) return NULL;
+	return w_get_item(W, W->index);
+}
+
+/* Record re-patch issued by user: n port pairs, first is out -> in */
+void nj_log_action( NJ* nj, const char* verb, Port* out, Port* in, unsigned int n ) {
+	Graph* g = nj->graph;
+	Change* c = change_add( &nj->changes, jack_get_time(), g->generation, true );
+
+	snprintf( c->text, CHANGE_TEXT, "%s %s%s:%s -> %s:%s", verb,
+		n > 1 ? "many, first " : "",
+		port_client_name(g, out), port_name(g, out),
+		port_client_name(g, in), port_name(g, in) );
+}
+
+/* Question in status line, true on 'y' */
+bool nj_confirm( NJ* nj, const char* msg ) {
+	WINDOW* w = nj->status_window;
+
+	wmove(w, 0, 0);
+	wclrtoeol(w);
+	wattron(w, COLOR_PAIR(5));
+	mvwprintw(w, 0, 1, "%s (y/n)", msg);
+	wattroff(w, COLOR_PAIR(5));
+	wrefresh(w);
+
+	wtimeout(w, -1);
+	int c = wgetch(w);
+	wtimeout(w, KEY_TIMEOUT);
+	return c == 'y' || c == 'Y';
+}
 
-	Port* p = list->data;
-	return p;
+/* Ask before connection closing feedback loop through client of out */
+bool nj_confirm_loop( NJ* nj, Port* out ) {
+	char msg[128];
+	snprintf(msg, sizeof(msg), "Connection closes feedback loop through %s, connect anyway?",
+		port_client_name(nj->graph, out));
+	if ( nj_confirm(nj, msg) ) return true;
+
+	nj->err_msg = CONNECT_CANCELLED;
+	return false;
+}
+
+/* Warn when connection would close feedback loop */
+bool nj_allow_connect( NJ* nj, Port* out, Port* in ) {
+	if ( ! connect_makes_loop(&nj->trace, nj->graph, out, in) ) return true;
+	return nj_confirm_loop( nj, out );
+}
+
+/* Connect selected outputs to selected inputs: one to many,
+ * many to one or pairwise in list order */
+bool nj_connect_selection( NJ* nj ) {
+	Window* Wsrc = nj->windows;
+	Window* Wdst = nj->windows + 1;
+	bool ret = true;
+
+	unsigned int size = (Wsrc->count > Wdst->count ? Wsrc->count : Wdst->count) + 1;
+	Port** src = malloc( size * sizeof(Port*) );
+	Port** dst = malloc( size * sizeof(Port*) );
+	unsigned int nsrc = w_sel_collect( Wsrc, (void**) src );
+	unsigned int ndst = w_sel_collect( Wdst, (void**) dst );
+
+	unsigned int i, n;
+	if ( nsrc == 0 || ndst == 0 ) {
+		n = 0;
+		ret = false;
+	} else if ( nsrc == 1 || ndst == 1 ) {
+		n = nsrc > ndst ? nsrc : ndst;
+	} else {
+		n = nsrc < ndst ? nsrc : ndst;
+	}
+
+	/* Pairs in place, single side repeated */
+	for ( i=1; i < n; i++ ) {
+		if ( nsrc == 1 ) src[i] = src[0];
+		if ( ndst == 1 ) dst[i] = dst[0];
+	}
+
+	/* One question for whole batch, loop may close through its own pairs */
+	i = connect_batch_makes_loop( &nj->trace, nj->graph, src, dst, n );
+	if ( i < n && ! nj_confirm_loop(nj, src[i]) ) n = 0;
+
+	for ( i=0; i < n; i++ ) {
+		if ( port_connect(nj->client, nj->graph, src[i], dst[i]) )
+			ret = false;
+	}
+	if ( n ) {
+		nj_log_action( nj, "connect", src[0], dst[0], n );
+		w_sel_clear(Wsrc);
+		w_sel_clear(Wdst);
+	}
+
+	free(src);
+	free(dst);
+	return ret;
 }
 
 bool nj_connect( NJ* nj ) {
 	Window* Wsrc = nj->windows;
 	Window* Wdst = nj->windows + 1;
 
+	if ( w_sel_count(Wsrc) || w_sel_count(Wdst) )
+		return nj_connect_selection( nj );
+
 	Port* src = w_get_selected_port(Wsrc);
 	if(!src) return false;
 
 	Port* dst = w_get_selected_port(Wdst);
 	if(!dst) return false;
 
-	if (jack_connect(nj->client, src->name, dst->name) ) return false;
+	if ( ! nj_allow_connect(nj, src, dst) ) return true;
+
+	if ( port_connect(nj->client, nj->graph, src, dst) ) return false;
+	nj_log_action( nj, "connect", src, dst, 1 );
 
 	/* Move selections to next items */
 	w_item_next(Wsrc);
@@ -183,26 +456,39 @@ bool nj_connect( NJ* nj ) {
 	return true;
 }
 
+/* Disconnect selected connections or current one */
 bool nj_disconnect( NJ* nj ) {
 	Window* W = nj->windows + 2;
+	bool ret = true;
 
-	JSList* list_item = jack_slist_nth(W->list, W->index);
-	if ( ! list_item) return false;
+	Connection** con = malloc( (W->count + 1) * sizeof(Connection*) );
+	unsigned int i, n = w_sel_collect( W, (void**) con );
+	if ( n == 0 ) ret = false;
 
-	Connection* c = list_item->data;
-	int ret = jack_disconnect(nj->client, c->out->name, c->in->name);
-	if ( ret != 0 ) return false;
+	for ( i=0; i < n; i++ ) {
+		Connection* c = con[i];
+		if ( port_disconnect(nj->client, nj->graph, c->out, c->in) )
+			ret = false;
+	}
+	if ( n ) nj_log_action( nj, "disconnect", con[0]->out, con[0]->in, n );
 
-	return true;
+	free(con);
+	w_sel_clear(W);
+	return ret;
 }
 
 bool nj_disconnect_all( NJ* nj ) {
 	Window* W = nj->windows + 2;
 
-	JSList* node;
-	for ( node=W->list; node; node=jack_slist_next(node) ) {
-		Connection* c = node->data;
-		int ret = jack_disconnect(nj->client, c->out->name, c->in->name);
+	if ( W->count ) {
+		Connection* c = w_get_item(W, 0);
+		nj_log_action( nj, "disconnect", c->out, c->in, W->count );
+	}
+
+	unsigned int i;
+	for ( i=0; i < W->count; i++ ) {
+		Connection* c = w_get_item(W, i);
+		int ret = port_disconnect(nj->client, nj->graph, c->out, c->in);
 		if ( ret != 0 ) return false;
 	}
 	return true;
@@ -236,6 +522,206 @@ Window* nj_get_selected_window( NJ* nj ) {
 	return &( nj->windows[ nj->window_selection ] );
 }
 
+/* Add items of current client to selection, its run in list */
+void nj_select_client( NJ* nj ) {
+	w_sel_run( nj_get_selected_window(nj) );
+}
+
+void nj_select_clear( NJ* nj ) {
+	unsigned short i;
+	for ( i=0; i < 3; i++ )
+		w_sel_clear( nj->windows + i );
+}
+
+/* Unchanged window keeps its positions, selection and runs, only
+ * items move to slice of new generation */
+void nj_assign_view( Window* W, bool changed, void* items, unsigned int count, size_t item_size ) {
+	if ( ! changed && count == W->count ) {
+		w_move_list( W, items );
+		return;
+	}
+	w_assign_list( W, items, count, item_size );
+}
+
+/* Point windows at current type slices of model, changed flags per
+ * window or NULL for all */
+void nj_assign_views( NJ* nj, bool* changed ) {
+	Graph* g = nj->graph;
+	bool all[3] = { true, true, true };
+	Range r;
+	unsigned long long t;
+
+	if ( ! changed ) changed = all;
+
+	t = perf_start();
+	r = select_ports( g, JackPortIsOutput, nj->ports_type );
+	perf_stop( PERF_SELECT_PORTS, t );
+	nj_assign_view( nj->windows, changed[0], g->ports + r.start, r.count, sizeof(Port) );
+
+	t = perf_start();
+	r = select_ports( g, JackPortIsInput, nj->ports_type );
+	perf_stop( PERF_SELECT_PORTS, t );
+	nj_assign_view( nj->windows+1, changed[1], g->ports + r.start, r.count, sizeof(Port) );
+
+	r = select_connections( g, nj->ports_type );
+	nj_assign_view( nj->windows+2, changed[2], g->cons + r.start, r.count, sizeof(Connection) );
+
+	nj->need_mark = true;
+	nj->grid_redraw = true;
+}
+
+/* Model holds all types, so switching is only a view change */
+void nj_set_type( NJ* nj, unsigned short type ) {
+	nj->ports_type = type;
+
+	if ( type == PORT_TYPE_ALL ) {
+		nj->windows[2].name = CON_NAME_ALL;
+	} else if ( type == port_type_id(JACK_DEFAULT_AUDIO_TYPE) ) {
+		nj->windows[2].name = CON_NAME_A;
+	} else if ( type == port_type_id(JACK_DEFAULT_MIDI_TYPE) ) {
+		nj->windows[2].name = CON_NAME_M;
+	} else {
+		snprintf(nj->con_name, sizeof(nj->con_name), "%s Connections", port_type_name(type));
+		nj->windows[2].name = nj->con_name;
+	}
+
+	/* Type marker column only when types are mixed */
+	unsigned short i;
+	for ( i=0; i < 3; i++ ) {
+		Window* W = nj->windows + i;
+		if ( W->tagged != (type == PORT_TYPE_ALL) ) {
+			W->tagged = (type == PORT_TYPE_ALL);
+			w_layout( W );
+		}
+	}
+
+	nj_select_clear( nj );
+	nj_assign_views( nj, NULL );
+}
+
+/* Next or previous type which has ports on server */
+void nj_cycle_type( NJ* nj, int dir ) {
+	unsigned short count = port_type_count();
+	unsigned short type = nj->ports_type;
+	unsigned short i;
+
+	if ( type == PORT_TYPE_ALL ) /* continue from either end */
+		type = ( dir > 0 ) ? count - 1 : 0;
+
+	for ( i=0; i < count; i++ ) {
+		type = (type + count + dir) % count;
+		if ( select_ports(nj->graph, JackPortIsOutput, type).count ||
+		     select_ports(nj->graph, JackPortIsInput, type).count ) {
+			nj_set_type( nj, type );
+			return;
+		}
+	}
+}
+
+bool nj_type_shown( NJ* nj, unsigned short type ) {
+	return nj->ports_type == PORT_TYPE_ALL || nj->ports_type == type;
+}
+
+/* Windows whose rows differ between generations, from diff. Marks of
+ * port windows follow connections of selected ports, or any when whole
+ * flow is traced. Loop marks of connections follow any connection */
+void nj_changed_windows( NJ* nj, Graph* old, Graph* g, GraphDiff* d, bool* changed ) {
+	Port* sel_out = w_get_selected_port( nj->windows );
+	Port* sel_in = w_get_selected_port( nj->windows + 1 );
+	DiffList* ports[2] = { &d->ports_added, &d->ports_removed };
+	DiffList* cons[2] = { &d->cons_added, &d->cons_removed };
+	unsigned int i, j;
+
+	/* Names are shown in every window */
+	bool renamed = d->ports_renamed.count != 0;
+	changed[0] = changed[1] = renamed || ( d->latency_changed && nj->show_latency );
+	changed[2] = renamed;
+
+	for ( j=0; j < 2; j++ ) {
+		for ( i=0; i < ports[j]->count; i++ ) {
+			Port* p = ports[j]->items[i];
+			if ( nj_type_shown(nj, p->type) )
+				changed[ (p->flags & JackPortIsOutput) ? 0 : 1 ] = true;
+		}
+	}
+
+	bool looped = old->flow.looped_count || g->flow.looped_count;
+	for ( j=0; j < 2; j++ ) {
+		for ( i=0; i < cons[j]->count; i++ ) {
+			Connection* c = cons[j]->items[i];
+			if ( looped || nj_type_shown(nj, c->type) )
+				changed[2] = true;
+			if ( nj->tracing ||
+			     ( sel_out && c->out->uuid == sel_out->uuid ) ||
+			     ( sel_in && c->in->uuid == sel_in->uuid ) )
+				changed[0] = changed[1] = true;
+		}
+	}
+}
+
+/* Switch UI to another generation, reference is passed in.
+ * Generation without changes against current one is dropped, windows
+ * it leaves as they are are not assigned nor drawn again */
+void nj_set_graph( NJ* nj, Graph* g ) {
+	Graph* old = nj->graph;
+	bool changed[3] = { true, true, true };
+	unsigned long long t = perf_trace_start();
+
+	/* Cost of last update, also when it brings no change */
+	nj->update_allocs = g->allocs;
+	nj->update_heap_allocs = g->heap_allocs;
+	nj->update_jack_calls = g->jack_calls;
+
+	if ( old ) {
+		GraphDiff* d = &nj->diff;
+		graph_diff( old, g, d );
+		bool same = graph_diff_empty( d );
+		if ( ! same ) {
+			snprintf( nj->diff_msg, sizeof(nj->diff_msg),
+				"%s: ports +%u -%u ~%u, connections +%u -%u, latency ~%u", GRAPH_CHANGED,
+				d->ports_added.count, d->ports_removed.count, d->ports_renamed.count,
+				d->cons_added.count, d->cons_removed.count, d->latency_changed );
+			nj->err_msg = nj->diff_msg;
+
+			Change* c = change_add( &nj->changes, jack_get_time(), g->generation, false );
+			snprintf( c->text, CHANGE_TEXT, "%s", nj->diff_msg );
+		}
+
+		if ( same ) {
+			perf_trace_span( "set_graph dropped", t, g->generation );
+			graph_unref( g );
+			return;
+		}
+		nj_changed_windows( nj, old, g, d, changed );
+	}
+
+	/* Selection follows ports and connections, not list positions */
+	unsigned short i;
+	unsigned int gone = 0;
+	for ( i=0; i < 3; i++ )
+		if ( changed[i] ) w_sel_save( nj->windows + i );
+
+	nj->graph = g;
+	perf_trace_mark( "ports", g->count );
+	perf_trace_mark( "connections", g->con_count );
+	if ( atomic_load_explicit(&perf_tracing, memory_order_relaxed) )
+		perf_trace_mark( "graph", graph_hash(g) );
+	bitset_resize( &nj->marks, g->count );
+	nj->marked_out = nj->marked_in = NULL;
+	nj_assign_views( nj, changed );
+
+	for ( i=0; i < 3; i++ )
+		if ( changed[i] ) gone += w_sel_restore( nj->windows + i );
+	if ( gone && old ) {
+		size_t len = strlen( nj->diff_msg );
+		snprintf( nj->diff_msg + len, sizeof(nj->diff_msg) - len, ", %u selected gone", gone );
+	}
+
+	/* Views do not point into old one anymore */
+	graph_unref( old );
+	perf_trace_span( "set_graph", t, g->generation );
+}
+
 void nj_set_redraw( NJ* nj ) {
 	Window* sw = nj_get_selected_window( nj );
 	switch ( sw->type ) {
@@ -250,13 +736,281 @@ void nj_set_redraw( NJ* nj ) {
 	nj->need_mark = true;
 }
 
-int graph_order_handler(void *arg) {
+void nj_redraw_all( NJ* nj ) {
+	unsigned short i;
+	for ( i=0; i < 3; i++ )
+		nj->windows[i].redraw = true;
+	nj->grid_redraw = true;
+}
+
+void nj_show_latency( NJ* nj, bool show ) {
+	unsigned short i;
+
+	nj->show_latency = show;
+	for ( i=0; i < 2; i++ ) {
+		nj->windows[i].latency = show;
+		w_layout( nj->windows + i );
+	}
+	nj_redraw_all( nj );
+	if ( show ) nj->err_msg = LATENCY_SHOWN;
+}
+
+/* Cursor move of navigation key, 0 if it is not one */
+int nav_delta( Window* W, int c ) {
+	int page = W->height > 3 ? W->height - 2 : 1;
+
+	switch ( c ) {
+		case 'j':
+		case KEY_DOWN:
+			return 1;
+		case 'k':
+		case KEY_UP:
+			return -1;
+		case KEY_NPAGE:
+			return page;
+		case KEY_PPAGE:
+			return -page;
+	}
+	return 0;
+}
+
+/* Apply all pending navigation keys before next redraw,
+ * so holding a key does not queue up redraws */
+void nj_drain_nav_keys( NJ* nj, Window* W, int c ) {
+	w_item_move( W, nav_delta(W, c) );
+
+	wtimeout( nj->status_window, 0 );
+	while ( (c = wgetch(nj->status_window)) != ERR ) {
+		int delta = nav_delta( W, c );
+		if ( delta == 0 ) {
+			ungetch( c );
+			break;
+		}
+		w_item_move( W, delta );
+	}
+	wtimeout( nj->status_window, KEY_TIMEOUT );
+}
+
+/* Main loop has work: wake it from waiting for key. One byte stays
+ * in pipe until loop reads it, however many events come */
+void nj_wake( NJ* nj ) {
+	if ( atomic_exchange( &nj->wake_sent, true ) ) return;
+	if ( write( nj->wake[1], "", 1 ) < 0 ) { /* full, loop wakes anyway */ }
+}
+
+/* Next key, ERR when timeout passes or model has work first */
+int nj_wait_key( NJ* nj, int timeout ) {
+	struct pollfd fds[2] = { { STDIN_FILENO, POLLIN, 0 }, { nj->wake[0], POLLIN, 0 } };
+	char buf[16];
+
+	/* Keys ncurses holds already */
+	wtimeout( nj->status_window, 0 );
+	int c = wgetch( nj->status_window );
+	wtimeout( nj->status_window, KEY_TIMEOUT );
+	if ( c != ERR ) return c;
+
+	if ( poll( fds, 2, timeout ) <= 0 ) return ERR;
+	if ( fds[1].revents ) {
+		atomic_store( &nj->wake_sent, false );
+		while ( read( nj->wake[0], buf, sizeof(buf) ) > 0 );
+	}
+	return fds[0].revents ? wgetch( nj->status_window ) : ERR;
+}
+
+void nj_push_event( NJ* nj, enum EventType type, jack_port_id_t a, jack_port_id_t b ) {
+	unsigned int head = atomic_load_explicit( &nj->ev_head, memory_order_relaxed );
+	unsigned int tail = atomic_load_explicit( &nj->ev_tail, memory_order_acquire );
+
+	if ( head - tail == EVENTS_SIZE ) {
+		atomic_store( &nj->ev_resync, true );
+		nj_wake( nj );
+		return;
+	}
+
+	PortEvent* e = nj->events + (head & (EVENTS_SIZE - 1));
+	e->type = type;
+	e->a = a;
+	e->b = b;
+	e->time = perf_start();
+	atomic_store_explicit( &nj->ev_head, head + 1, memory_order_release );
+	nj_wake( nj );
+}
+
+void port_registration_handler( jack_port_id_t port, int reg, void *arg ) {
+	perf_trace_mark( "port_registration", port );
+	nj_push_event( arg, reg ? EV_PORT_REG : EV_PORT_UNREG, port, 0 );
+}
+
+void port_connect_handler( jack_port_id_t a, jack_port_id_t b, int connect, void *arg ) {
+	perf_trace_mark( "port_connect", a );
+	nj_push_event( arg, connect ? EV_CONNECT : EV_DISCONNECT, a, b );
+}
+
+void latency_handler( jack_latency_callback_mode_t mode, void *arg ) {
+	NJ* nj = arg;
+	perf_trace_mark( "latency", mode );
+	atomic_store( &nj->latency_changed, true );
+	nj_wake( nj );
+}
+
+void port_rename_handler( jack_port_id_t port, const char* old_name, const char* new_name, void *arg ) {
+	NJ* nj = arg;
+	perf_trace_mark( "port_rename", port );
+	atomic_store( &nj->ev_resync, true );
+	nj_wake( nj );
+}
+
+/* Apply queued port events by port id to copy of current generation,
+ * full refresh only when events were lost or model can not follow them */
+void nj_apply_events( NJ* nj ) {
+	Graph* g = NULL;
+	bool changed = false;
+	unsigned int head = atomic_load_explicit( &nj->ev_head, memory_order_acquire );
+	unsigned int tail = atomic_load_explicit( &nj->ev_tail, memory_order_relaxed );
+	unsigned int drained = head - tail;
+	unsigned long long t = drained ? perf_trace_start() : 0;
+
+	if ( drained && ! nj->ev_time )
+		nj->ev_time = nj->events[tail & (EVENTS_SIZE - 1)].time;
+
+	if ( atomic_exchange( &nj->ev_resync, false ) )
+		nj->want_refresh = true;
+
+	for ( ; tail != head && ! nj->want_refresh; tail++ ) {
+		PortEvent* e = nj->events + (tail & (EVENTS_SIZE - 1));
+		if ( ! g )
+			g = graph_clone( nj->graph, atomic_fetch_add(&nj->generation, 1) + 1 );
+
+		/* Run of registrations or removals, as client registering
+		 * its ports or leaving makes, reshapes ports table once */
+		if ( e->type == EV_PORT_REG || e->type == EV_PORT_UNREG ) {
+			enum EventType type = e->type;
+			unsigned int n = 0;
+			for ( ; tail != head; tail++ ) {
+				e = nj->events + (tail & (EVENTS_SIZE - 1));
+				if ( e->type != type ) break;
+				nj->run_ids[n++] = e->a;
+			}
+			tail--;
+			if ( type == EV_PORT_UNREG ) {
+				changed |= graph_remove_ports( g, nj->run_ids, n );
+				continue;
+			}
+			if ( ! graph_add_ports( nj->client, g, nj->run_ids, n ) )
+				nj->want_refresh = true;
+			changed = true;
+			continue;
+		}
+
+		Port* a = get_port_by_id( g, e->a );
+		Port* b = get_port_by_id( g, e->b );
+
+		switch ( e->type ) {
+			case EV_PORT_REG:
+			case EV_PORT_UNREG:
+				break;
+			case EV_CONNECT:
+				if ( a && b ) changed |= graph_connect( g, a, b );
+				break;
+			case EV_DISCONNECT:
+				if ( a && b ) changed |= graph_disconnect( g, a, b );
+				break;
+		}
+	}
+	/* Rebuild reads server state, so pending events are covered */
+	atomic_store_explicit( &nj->ev_tail, head, memory_order_release );
+
+	if ( atomic_exchange( &nj->latency_changed, false ) && ! nj->want_refresh ) {
+		if ( ! g )
+			g = graph_clone( nj->graph, atomic_fetch_add(&nj->generation, 1) + 1 );
+		graph_read_latency( g );
+		changed = true;
+	}
+
+	if ( changed && ! nj->want_refresh ) {
+		graph_finish( g );
+		nj_set_graph( nj, g );
+	} else if ( g ) {
+		graph_unref( g );
+	}
+	perf_trace_span( "queue drain", t, drained );
+}
+
+void* builder_thread( void* arg ) {
 	NJ* nj = arg;
-	nj->err_msg = GRAPH_CHANGED;
-	nj->want_refresh = true;
+
+	perf_trace_thread( "builder" );
+	pthread_mutex_lock( &nj->build_lock );
+	while ( true ) {
+		while ( ! nj->build_requested && ! nj->quit )
+			pthread_cond_wait( &nj->build_cond, &nj->build_lock );
+		if ( nj->quit ) break;
+		nj->build_requested = false;
+		pthread_mutex_unlock( &nj->build_lock );
+
+		unsigned long long t = perf_trace_start();
+		Graph* g = graph_build( nj->client, atomic_fetch_add(&nj->generation, 1) + 1,
+			&nj->build_scratch );
+		perf_trace_span( "rebuild", t, g->generation );
+		graph_unref( atomic_exchange(&nj->pending, g) ); /* not taken yet */
+		nj_wake( nj );
+
+		pthread_mutex_lock( &nj->build_lock );
+		nj->building = nj->build_requested;
+	}
+	pthread_mutex_unlock( &nj->build_lock );
+	return NULL;
+}
+
+void nj_request_build( NJ* nj ) {
+	pthread_mutex_lock( &nj->build_lock );
+	nj->build_requested = true;
+	nj->building = true;
+	pthread_cond_signal( &nj->build_cond );
+	pthread_mutex_unlock( &nj->build_lock );
+}
+
+bool nj_building( NJ* nj ) {
+	pthread_mutex_lock( &nj->build_lock );
+	bool ret = nj->building;
+	pthread_mutex_unlock( &nj->build_lock );
+	return ret;
+}
+
+/* Bring UI generation up to date: take rebuilt one, else follow
+ * port events. Events wait while rebuild is running */
+void nj_sync( NJ* nj ) {
+	bool busy = nj_building( nj ); /* before pending, it is published first */
+
+	Graph* g = atomic_exchange( &nj->pending, NULL );
+	if ( g ) nj_set_graph( nj, g );
+	if ( busy ) return;
+
+	nj_apply_events( nj );
+	if ( nj->want_refresh ) {
+		nj->want_refresh = false;
+		nj_request_build( nj );
+	}
+}
+
+int xrun_handler( void *arg ) {
+	NJ* nj = arg;
+	perf_trace_mark( "xrun", 0 );
+	xrun_record( &nj->xruns, jack_get_time(), jack_get_xrun_delayed_usecs(nj->client) );
 	return 0;
 }
 
+void* sampler_thread( void* arg ) {
+	NJ* nj = arg;
+	struct timespec period = { 0, DSP_PERIOD * 1000000L };
+
+	while ( atomic_load(&nj->sampling) ) {
+		dsp_record( &nj->dsp, jack_cpu_load(nj->client) );
+		nanosleep( &period, NULL );
+	}
+	return NULL;
+}
+
 int buffer_size_handler( jack_nframes_t buffer_size, void *arg ) {
 	NJ* nj = arg;
 	nj->buffer_size = buffer_size;
@@ -272,9 +1026,99 @@ int sample_rate_handler( jack_nframes_t sample_rate, void *arg ) {
 }
 
 int process_handler( jack_nframes_t nframes, void *arg ) {
+	NJ* nj = arg;
+	meter_process( &nj->meters, nframes );
 	return 0;
 }
 
+/* Meter selected audio and MIDI outputs, or current one */
+void nj_meter_start( NJ* nj ) {
+	Window* W = nj->windows;
+	unsigned short audio = port_type_id(JACK_DEFAULT_AUDIO_TYPE);
+	unsigned short midi = port_type_id(JACK_DEFAULT_MIDI_TYPE);
+
+	Port** sel = malloc( (W->count + 1) * sizeof(Port*) );
+	unsigned int i, n = w_sel_collect( W, (void**) sel );
+	if ( n == 0 && W->count ) sel[n++] = w_get_selected_port( W );
+
+	jack_port_t* sources[METER_CHANNELS];
+	unsigned int count = 0;
+	for ( i=0; i < n && count < METER_CHANNELS; i++ )
+		if ( sel[i]->type == audio || sel[i]->type == midi )
+			sources[count++] = sel[i]->jport;
+	free(sel);
+
+	if ( ! meter_start( &nj->meters, nj->client, sources, count ) ) {
+		meter_stop( &nj->meters, nj->client );
+		nj->err_msg = ERR_METER;
+		return;
+	}
+	w_sel_clear( W );
+	nj->metering = W->metered = true;
+	w_layout( W );
+	W->redraw = true;
+}
+
+void nj_meter_stop( NJ* nj ) {
+	Window* W = nj->windows;
+
+	meter_stop( &nj->meters, nj->client );
+	nj->metering = W->metered = false;
+	w_layout( W );
+	W->redraw = true;
+}
+
+/* Load windows from comma separated seconds, "10,60". Returns false
+ * when list is malformed or a window is longer than history kept */
+bool nj_set_load_windows( NJ* nj, const char* list ) {
+	unsigned short n = 1;
+	char* end;
+
+	nj->load_windows[0] = 0;
+	do {
+		long s = strtol( list, &end, 10 );
+		if ( end == list || s < 1 || s > LOAD_WINDOW_LIMIT || n > LOAD_WINDOWS_MAX )
+			return false;
+		nj->load_windows[n++] = s;
+		list = end + 1;
+	} while ( *end == ',' );
+
+	if ( *end ) return false;
+	nj->load_window_count = n;
+	return true;
+}
+
+/* Sparkline of load window, each column is peak of its samples,
+ * scaled to window peak, then percentiles */
+void nj_format_load( NJ* nj, char* buf, size_t size, int width ) {
+	unsigned short seconds = nj->load_windows[nj->load_window];
+	unsigned short samples[DSP_HISTORY / 2];
+	unsigned int n = dsp_window( &nj->dsp, samples, seconds * 1000 / DSP_PERIOD );
+	char spark[SPARK_MAX + 1];
+	unsigned short top = 100; /* 1% at least */
+	unsigned int i, cells = width < 0 ? 0 : width;
+
+	if ( cells > SPARK_MAX ) cells = SPARK_MAX;
+	if ( cells > n ) cells = n;
+
+	for ( i=0; i < n; i++ )
+		if ( samples[i] > top ) top = samples[i];
+
+	for ( i=0; i < cells; i++ ) {
+		unsigned int j, end = (i + 1) * n / cells;
+		unsigned short peak = 0;
+		for ( j = i * n / cells; j < end; j++ )
+			if ( samples[j] > peak ) peak = samples[j];
+		spark[i] = SPARK_LEVELS[ peak * (sizeof(SPARK_LEVELS) - 2) / top ];
+	}
+	spark[cells] = '\0';
+
+	DspStats st;
+	dsp_stats( samples, n, &st );
+	snprintf( buf, size, "DSP %us [%s] p50:%.2f p99:%.2f max:%.2f",
+		seconds, spark, st.p50, st.p99, st.max );
+}
+
 void draw_status( NJ* nj ) {
 	WINDOW* w = nj->status_window;
 
@@ -283,7 +1127,27 @@ void draw_status( NJ* nj ) {
 	// Message
 	int color;
 	const char* msg;
-	if ( nj->err_msg != NULL ) {
+	char debug[128];
+	unsigned short cols = getmaxx(w);
+
+	/* Xruns in red while there were some in last minute */
+	char xr[32];
+	unsigned int recent = xrun_since( &nj->xruns, jack_get_time() - XRUN_RATE_WINDOW );
+	int xr_len = snprintf(xr, sizeof(xr), "XR:%u %u/min ", xrun_count(&nj->xruns), recent);
+
+	if ( nj->show_debug ) {
+		Graph* g = nj->graph;
+		snprintf(debug, sizeof(debug),
+			"gen:%lu ports:%u cons:%u jack calls:%u allocs:%u heap:%u",
+			g->generation, g->count, g->con_count, nj->update_jack_calls,
+			nj->update_allocs, nj->update_heap_allocs);
+		msg = debug;
+		color = 7;
+	} else if ( nj->load_window ) {
+		nj_format_load( nj, debug, sizeof(debug), cols - 23 - xr_len - 46 );
+		msg = debug;
+		color = 7;
+	} else if ( nj->err_msg != NULL ) {
 		msg = nj->err_msg;
 		nj->err_msg = NULL;
 		color = 6;
@@ -299,13 +1163,26 @@ void draw_status( NJ* nj ) {
 	mvwprintw(w, 0, 1, msg);
 	wattroff(w, COLOR_PAIR(color));
 
-	unsigned short cols = getmaxx(w);
+	unsigned int looped = nj->graph->flow.looped_count;
+	if ( looped ) {
+		char loop[32];
+		int len = snprintf(loop, sizeof(loop), "LOOP:%u ", looped);
+		wattron(w, COLOR_PAIR(8));
+		mvwprintw(w, 0, cols-23-xr_len-len, "%s", loop);
+		wattroff(w, COLOR_PAIR(8));
+	}
+
+	int xr_color = recent ? 8 : 7;
+	wattron(w, COLOR_PAIR(xr_color));
+	mvwprintw(w, 0, cols-23-xr_len, "%s", xr);
+	wattroff(w, COLOR_PAIR(xr_color));
+
 	wattron(w, COLOR_PAIR(7));
 	mvwprintw(w, 0, cols-23,
 		"%d/%d DSP:%4.2f%s",
 		nj->sample_rate,
 		nj->buffer_size,
-		jack_cpu_load( nj->client ),
+		dsp_last( &nj->dsp ),
 		nj->rt ? "@RT" : "!RT"
 	);
 	wattroff(w, COLOR_PAIR(7));
@@ -313,19 +1190,66 @@ void draw_status( NJ* nj ) {
 	wrefresh(w);
 }
 
+/* Timers panel of debug overlay in bottom right corner, drawn over
+ * other windows after they are refreshed */
+void nj_draw_perf( NJ* nj ) {
+	unsigned short rows, cols, i;
+	double last, avg;
+	PerfFrames frames;
+
+	getmaxyx(stdscr, rows, cols);
+	if ( rows < WPERF_H + 1 || cols < WPERF_W ) return;
+	if ( ! nj->perf_window )
+		nj->perf_window = newwin(WPERF_H, WPERF_W, 0, 0);
+	mvwin(nj->perf_window, rows - 1 - WPERF_H, cols - WPERF_W);
+
+	WINDOW* w = nj->perf_window;
+	werase(w);
+	wattron(w, COLOR_PAIR(7));
+	mvwprintw(w, 1, 2, "%-20s %9s %9s", "", "last ms", "avg ms");
+	for ( i=0; i < PERF_TIMERS; i++ ) {
+		perf_get( i, &last, &avg );
+		mvwprintw(w, 2 + i, 2, "%-20s %9.3f %9.3f", perf_name(i), last, avg);
+	}
+	mvwprintw(w, 2 + i, 2, "refresh: jack calls:%u heap allocs:%u",
+		nj->update_jack_calls, nj->update_heap_allocs);
+	perf_frames( &frames );
+	mvwprintw(w, 3 + i, 2, "frame: %llu/%.0f bytes %llu/%.1f writes",
+		frames.last.bytes, frames.avg_bytes, frames.last.writes, frames.avg_writes);
+	wattroff(w, COLOR_PAIR(7));
+	box(w, 0, 0);
+
+	touchwin(w);
+	wrefresh(w);
+}
+
+void nj_show_debug( NJ* nj, bool show ) {
+	nj->show_debug = show;
+	perf_enable( show );
+	if ( ! show && nj->perf_window ) {
+		delwin( nj->perf_window );
+		nj->perf_window = NULL;
+		/* Uncover what panel hid */
+		clearok( curscr, TRUE );
+		nj_redraw_all( nj );
+	}
+}
+
 void nj_redraw_windows( NJ* nj ) {
 	unsigned short i;
 	for ( i=0; i < 3; i++ ) {
 		Window* w = nj->windows + i;
 		if ( w->redraw ) {
+			unsigned long long t = perf_start();
 			w->redraw = false;
-			w_draw( w );
+			w_draw( w, nj->graph, &nj->marks, &nj->meters );
+			perf_stop( PERF_DRAW_OUT + i, t );
 		}
 	}
 }
 
 enum Orientation { ORT_VERT, ORT_HORIZ };
-void grid_draw_port_list ( WINDOW* w, JSList* list, int start, enum Orientation ort ) {
+void grid_draw_port_list ( WINDOW* w, Graph* g, Port* ports, unsigned int count, int start, enum Orientation ort, bool latency ) {
 	unsigned short rows, cols;
 	getmaxyx(w, rows, cols);
 
@@ -338,16 +1262,21 @@ void grid_draw_port_list ( WINDOW* w, JSList* list, int start, enum Orientation
 		mvwhline(w, row, col, ACS_HLINE, cols);
 	}
 
-	JSList* node;
-	for ( node=jack_slist_nth(list,0); node; node=jack_slist_next(node) ) {
-		Port* p = node->data;
+	unsigned int i;
+	for ( i=0; i < count; i++ ) {
+		Port* p = ports + i;
 
 		/* Draw port name */
 		wattron(w, COLOR_PAIR(1));
 		if ( ort == ORT_VERT ) {
-			mvwprintw(w, row++, ++col, "%s", p->name);
+			mvwprintw(w, row++, ++col, "%s:%s", port_client_name(g, p), port_name(g, p));
 		} else { /* assume ORT_HORIZ */
-			mvwprintw(w, ++row, col, "%s", p->name);
+			mvwprintw(w, ++row, col, "%s:%s", port_client_name(g, p), port_name(g, p));
+		}
+		if ( latency ) {
+			char buf[32];
+			latency_label( buf, sizeof(buf), p );
+			waddstr(w, buf);
 		}
 		wattroff(w, COLOR_PAIR(1));
 
@@ -363,32 +1292,44 @@ void grid_draw_port_list ( WINDOW* w, JSList* list, int start, enum Orientation
 void nj_draw_grid ( NJ* nj ) {
 	if ( ! nj->grid_redraw ) return;
 
+	unsigned long long t = perf_start();
 	nj->grid_redraw = false;
 
 	WINDOW* w = nj->grid_window;
-	JSList* list_out = nj->windows[0].list;
-	JSList* list_in  = nj->windows[1].list;
-	JSList* list_con = nj->windows[2].list;
+	Window* Wout = nj->windows;
+	Window* Win  = nj->windows + 1;
+	Window* Wcon = nj->windows + 2;
+	Port* ports_out = Wout->items;
+	Port* ports_in  = Win->items;
 
 	werase ( w );
+	unsigned int i;
 
 	/* IN */
-	int start_col = get_max_port_name ( list_out ) + 1;
-	grid_draw_port_list ( w, list_in, start_col, ORT_VERT );
+	int start_col = get_max_port_name ( nj->graph, ports_out, Wout->count ) + 1;
+	if ( nj->show_latency ) {
+		int max = 0;
+		for ( i=0; i < Wout->count; i++ ) {
+			char buf[32];
+			int len = latency_label( buf, sizeof(buf), ports_out + i );
+			if ( len > max ) max = len;
+		}
+		start_col += max;
+	}
+	grid_draw_port_list ( w, nj->graph, ports_in, Win->count, start_col, ORT_VERT, nj->show_latency );
 
 	/* OUT */
-	int start_row = jack_slist_length( list_in ) + 1;
-	grid_draw_port_list ( w, list_out, start_row, ORT_HORIZ );
+	int start_row = Win->count + 1;
+	grid_draw_port_list ( w, nj->graph, ports_out, Wout->count, start_row, ORT_HORIZ, nj->show_latency );
 
-	/* Draw Connections */
-	JSList* node;
-	for ( node=jack_slist_nth(list_con,0); node; node=jack_slist_next(node) ) {
-		Connection* c = node->data;
+	/* Draw Connections, port views are slices so position is pointer offset */
+	for ( i=0; i < Wcon->count; i++ ) {
+		Connection* c = w_get_item(Wcon, i);
 
-		int in_pos = jack_slist_find_pos ( list_in, c->in );
+		int in_pos = c->in - ports_in;
 		int col = start_col + 1 + in_pos * 2;
 
-		int out_pos = jack_slist_find_pos ( list_out, c->out );
+		int out_pos = c->out - ports_out;
 		int row = start_row + 1 + out_pos * 2;
 
 		wattron(w, COLOR_PAIR(2));
@@ -402,6 +1343,7 @@ void nj_draw_grid ( NJ* nj ) {
 	wattroff(w, COLOR_PAIR(1));
 
 	wrefresh(w);
+	perf_stop( PERF_DRAW_GRID, t );
 }
 
 bool init_jack( NJ* nj ) {
@@ -422,16 +1364,46 @@ bool init_jack( NJ* nj ) {
 	nj->rt = jack_is_realtime( nj->client );
 	nj->err_msg = NULL;
 	nj->want_refresh = false;
-
-	jack_set_graph_order_callback( nj->client, graph_order_handler, nj );
+	nj->show_debug = false;
+	nj->perf_window = NULL;
+	nj->show_latency = false;
+	atomic_init( &nj->latency_changed, false );
+	xrun_init( &nj->xruns );
+	change_init( &nj->changes );
+	dsp_init( &nj->dsp );
+	nj->load_window = 0;
+	atomic_init( &nj->ev_head, 0 );
+	atomic_init( &nj->ev_tail, 0 );
+	atomic_init( &nj->ev_resync, false );
+	nj->ev_time = 0;
+	atomic_init( &nj->wake_sent, false );
+	if ( pipe(nj->wake) ) {
+		ERR_OUT ("can not create wake pipe");
+		jack_client_close( nj->client );
+		return false;
+	}
+	fcntl( nj->wake[0], F_SETFL, O_NONBLOCK );
+	fcntl( nj->wake[1], F_SETFL, O_NONBLOCK );
+
+	jack_set_port_registration_callback( nj->client, port_registration_handler, nj );
+	jack_set_port_connect_callback( nj->client, port_connect_handler, nj );
+	jack_set_port_rename_callback( nj->client, port_rename_handler, nj );
+	jack_set_latency_callback( nj->client, latency_handler, nj );
+	jack_set_xrun_callback( nj->client, xrun_handler, nj );
 	jack_set_buffer_size_callback( nj->client, buffer_size_handler, nj );
 	jack_set_sample_rate_callback( nj->client, sample_rate_handler, nj );
 
-	/* NOTE: need minimal process callback for Jack1 to call graph order handler */
-	jack_set_process_callback ( nj->client, process_handler, NULL );
+	/* NOTE: need minimal process callback for Jack1 to deliver notifications,
+	 * it also runs meters */
+	meter_init( &nj->meters );
+	nj->metering = false;
+	jack_set_process_callback ( nj->client, process_handler, nj );
 
 	jack_activate( nj->client );
 
+	atomic_init( &nj->sampling, true );
+	pthread_create( &nj->sampler, NULL, sampler_thread, nj );
+
 	return true;
 }
 
@@ -444,6 +1416,8 @@ void show_help() {
 	struct help h[] = {
 		{ "a", "manage audio" },
 		{ "m", "manage MIDI" },
+		{ "t / SHIFT + t", "manage next / previous port type" },
+		{ "SHIFT + a", "manage all port types together" },
 		{ "g", "Toggle grid view" },
 		{ "TAB / SHIFT + j", "select next window" },
 		{ "SHIFT + TAB / K", "select previous window" },
@@ -451,13 +1425,24 @@ void show_help() {
 		{ "LEFT / h", "select output ports window" },
 		{ "RIGHT / l", "select input ports window" },
 		{ "UP / k", "select previous item on list" },
-		{ "DOWN / j", "select previous item on list" },
+		{ "DOWN / j", "select next item on list" },
+		{ "PGUP / PGDN", "move one page up / down" },
+		{ "[ / ]", "jump to previous / next client" },
 		{ "HOME", "select first item on list" },
 		{ "END", "select last item on list" },
-		{ "c / ENTER", "connect" },
-		{ "d / BACKSPACE", "disconnect" },
+		{ "s", "toggle item selection" },
+		{ "SHIFT + s", "select range from last toggled item" },
+		{ "SHIFT + c", "select all items of current client" },
+		{ "u", "clear selection" },
+		{ "c / ENTER", "connect (selected ports)" },
+		{ "d / BACKSPACE", "disconnect (selected connections)" },
 		{ "SHIFT + d", "disconnect all" },
+		{ "e", "toggle port and path latency" },
+		{ "f", "toggle signal flow trace of selected ports" },
 		{ "r", "refresh" },
+		{ "x", "xruns against graph changes" },
+		{ "SHIFT + m", "meter levels / MIDI activity of selected outputs / stop" },
+		{ "SHIFT + l", "DSP load history: next window / off" },
 		{ "q", "quit" },
 		{ "SHIFT + h / ?", "help info (just what you see right now ;-)" },
 		{ NULL, NULL }
@@ -490,45 +1475,140 @@ void show_help() {
 	delwin(w);
 }
 
-void nj_mark_ports ( NJ* nj, JSList* all_ports ) {
-	if ( ! nj->need_mark ) return;
-	nj->need_mark=false;
+/* Xruns and graph changes newest first, each xrun with change
+ * which came shortly before it */
+void show_xruns( NJ* nj ) {
+	unsigned short rows, cols;
+	getmaxyx(stdscr, rows, cols);
+
+	jack_time_t now = jack_get_time();
+	unsigned int xn = xrun_count( &nj->xruns );
+	unsigned int cn = nj->changes.count;
 
-	/* Unmark all ports */
-	JSList* node;
-	for ( node=all_ports; node; node=jack_slist_next(node) ) {
-		Port* p = node->data;
-		p->mark = false;
+	WINDOW* w = newwin(rows, cols, 0, 0);
+	wattron(w, COLOR_PAIR(6));
+	mvwprintw(w, 1, 2, "Xruns: %u total, %u in last minute", xn,
+		xrun_since(&nj->xruns, now - XRUN_RATE_WINDOW));
+	wattroff(w, COLOR_PAIR(6));
+
+	Xrun x;
+	bool have_x = xn && xrun_get( &nj->xruns, xn - 1, &x );
+	Change* c = change_get( &nj->changes, cn - 1 );
+	char line[256];
+	unsigned short row;
+	for ( row = 3; row < rows - 1 && (have_x || c); row++ ) {
+		int color = 1;
+		if ( have_x && ( ! c || x.time >= c->time ) ) {
+			int len = snprintf(line, sizeof(line), "%8.1fs  xrun %6.0fus",
+				(now - x.time) / 1e6, x.delay);
+
+			Change* cause = change_before( &nj->changes, x.time );
+			if ( cause && x.time - cause->time <= XRUN_CAUSE_WINDOW )
+				snprintf(line + len, sizeof(line) - len, "  %.0fms after gen %lu",
+					(x.time - cause->time) / 1e3, cause->generation);
+
+			color = 8;
+			xn--;
+			have_x = xn && xrun_get( &nj->xruns, xn - 1, &x );
+		} else {
+			snprintf(line, sizeof(line), "%8.1fs  gen %-6lu %s %s",
+				(now - c->time) / 1e6, c->generation,
+				c->own ? "made:" : "seen:", c->text);
+			cn--;
+			c = change_get( &nj->changes, cn - 1 );
+		}
+		wattron(w, COLOR_PAIR(color));
+		mvwaddnstr(w, row, 2, line, cols - 4);
+		wattroff(w, COLOR_PAIR(color));
 	}
 
-	/* Mark connected */
-	Port* current_out = w_get_selected_port( nj->windows );
-	Port* current_in  = w_get_selected_port( nj->windows + 1 );
+	wattron(w, COLOR_PAIR(1));
+	box(w, 0, 0);
+	wattroff(w, COLOR_PAIR(1));
+
+	wrefresh(w);
+	wgetch(w);
+	delwin(w);
+}
 
-	JSList* list_con = nj->windows[2].list;
-	for ( node=list_con; node; node=jack_slist_next(node) ) {
-		Connection* c = node->data;
-		if ( c->in == current_in )
-			c->out->mark = true;
+void nj_mark_ports ( NJ* nj ) {
+	if ( ! nj->need_mark ) return;
+	nj->need_mark=false;
 
-		if ( c->out == current_out )
-			c->in->mark = true;
+	unsigned long long t = perf_start();
+	if ( nj->tracing ) {
+		/* Downstream of selected output, upstream of selected input */
+		bitset_clear_all( &nj->marks );
+		nj->marked_out = w_get_selected_port( nj->windows );
+		nj->marked_in  = w_get_selected_port( nj->windows + 1 );
+		trace_mark( &nj->trace, nj->graph, nj->marked_out, &nj->marks );
+		trace_mark( &nj->trace, nj->graph, nj->marked_in, &nj->marks );
+		perf_stop( PERF_MARK_PORTS, t );
+		return;
 	}
+
+	/* Unmark peers of previous ports */
+	mark_peers( nj->graph, nj->marked_out, &nj->marks, false );
+	mark_peers( nj->graph, nj->marked_in, &nj->marks, false );
+
+	/* Mark connected */
+	nj->marked_out = w_get_selected_port( nj->windows );
+	nj->marked_in  = w_get_selected_port( nj->windows + 1 );
+	mark_peers( nj->graph, nj->marked_out, &nj->marks, true );
+	mark_peers( nj->graph, nj->marked_in, &nj->marks, true );
+	perf_stop( PERF_MARK_PORTS, t );
 }
 
-int main() {
+int main( int argc, char* argv[] ) {
 	enum {
 		VIEW_MODE_NORMAL,
 		VIEW_MODE_GRID
 	} ViewMode = VIEW_MODE_NORMAL;
 
 	unsigned short ret, rows, cols;
-	const char* PortsType = JACK_DEFAULT_MIDI_TYPE;
-	JSList* all_ports_list = NULL;
+	unsigned long long t, key_start = 0;
+	PerfIo frame_io;
+	int i, key = 0;
 	NJ nj;
+
+	nj_set_load_windows( &nj, LOAD_WINDOWS_DEFAULT );
+	for ( i=1; i < argc; i++ ) {
+		if ( strcmp(argv[i], "--trace") == 0 && i + 1 < argc ) {
+			if ( ! perf_trace_open(argv[++i]) ) {
+				fprintf( stderr, "Can not open trace file %s\n", argv[i] );
+				return 1;
+			}
+		} else if ( strcmp(argv[i], "--load-windows") == 0 && i + 1 < argc ) {
+			if ( ! nj_set_load_windows(&nj, argv[++i]) ) {
+				fprintf( stderr, "Load windows are 1 to %d seconds, up to %d of them: %s\n",
+					LOAD_WINDOW_LIMIT, LOAD_WINDOWS_MAX, argv[i] );
+				return 1;
+			}
+		} else {
+			fprintf( stderr, "Usage: %s [--trace FILE] [--load-windows SECONDS,...]\n", argv[0] );
+			return 1;
+		}
+	}
+	perf_trace_thread( "ui" );
+
 	nj.grid_window = NULL;
 	nj.grid_redraw = true;
 	nj.window_selection = 0;
+	nj.graph = NULL;
+	nj.marks.bits = NULL;
+	nj.marks.size = 0;
+	nj.marks.capacity = 0;
+	atomic_init( &nj.generation, 0 );
+	atomic_init( &nj.pending, NULL );
+	pthread_mutex_init( &nj.build_lock, NULL );
+	pthread_cond_init( &nj.build_cond, NULL );
+	nj.build_requested = nj.building = nj.quit = false;
+	arena_init( &nj.build_scratch );
+	graph_diff_init( &nj.diff );
+	nj.tracing = false;
+	trace_init( &nj.trace );
+	port_type_id(JACK_DEFAULT_AUDIO_TYPE); /* audio and MIDI always known */
+	nj.ports_type = port_type_id(JACK_DEFAULT_MIDI_TYPE);
 
 	/* Initialize ncurses */
 	initscr();
@@ -553,6 +1633,7 @@ int main() {
 	init_pair(7, COLOR_BLUE, -1);
 	init_pair(8, COLOR_RED, -1);
 	init_pair(9, COLOR_RED, COLOR_WHITE);
+	init_pair(10, COLOR_BLACK, COLOR_YELLOW);
 
 	if ( ! init_jack(&nj) ) {
 		ret = 2;
@@ -562,7 +1643,7 @@ int main() {
 	/* Create Help/Status Window */
 	nj.status_window = newwin(WSTAT_H, WSTAT_W, WSTAT_Y, WSTAT_X);
 	keypad(nj.status_window, true);
-	wtimeout(nj.status_window, 1000);
+	wtimeout(nj.status_window, KEY_TIMEOUT);
 
 	/* Create windows */
 	w_create(nj.windows, WOUT_H, WOUT_W, WOUT_Y, WOUT_Y, "Output Ports", WIN_PORTS);
@@ -570,27 +1651,48 @@ int main() {
 	w_create(nj.windows+2, WCON_H, WCON_W, WCON_Y, WCON_X, CON_NAME_M, WIN_CONNECTIONS);
 	nj.windows[nj.window_selection].selected = true;
 
-lists:
-	/* Build ports, connections list */
-	all_ports_list = build_ports( nj.client );
-	w_assign_list( nj.windows, select_ports(all_ports_list, JackPortIsOutput, PortsType) );
-	w_assign_list( nj.windows+1, select_ports(all_ports_list, JackPortIsInput, PortsType) );
-	w_assign_list( nj.windows+2, build_connections( nj.client, all_ports_list, PortsType ) );
-	nj.need_mark = true;
+	/* First generation is built right away, later ones in background */
+	nj_set_graph( &nj, graph_build(nj.client, atomic_fetch_add(&nj.generation, 1) + 1,
+		&nj.build_scratch) );
+	pthread_create( &nj.builder, NULL, builder_thread, &nj );
 
 loop:
+	/* Key handling lasts until its changes are to be drawn */
+	if ( key_start ) perf_trace_span( "key", key_start, key );
+	key_start = 0;
+
+	nj_sync( &nj );
+	t = perf_start();
+	if ( t && ! perf_io(&frame_io) ) frame_io.bytes = frame_io.writes = 0;
+
+	if ( nj.metering && meter_read(&nj.meters) )
+		nj.windows[0].redraw = true;
+
 	if ( ViewMode == VIEW_MODE_GRID ) {
 		nj_draw_grid( &nj );
 	} else { /* Assume VIEW_MODE_NORMAL */
-		nj_mark_ports( &nj, all_ports_list );
+		nj_mark_ports( &nj );
 		nj_redraw_windows( &nj );
 	}
 
 	draw_status( &nj );
+	if ( nj.show_debug ) nj_draw_perf( &nj );
+	if ( t ) perf_frame( t, &frame_io );
+
+	/* Events are on screen once model has them and no rebuild is due */
+	if ( nj.ev_time && ! nj_building(&nj) ) {
+		perf_stop( PERF_EVENT, nj.ev_time );
+		nj.ev_time = 0;
+	}
 
 	Window* selected_window = nj_get_selected_window(&nj);
 
-	int c = wgetch(nj.status_window);
+	/* Events and rebuilds wake it, meters need polling */
+	int c = nj_wait_key( &nj, nj.metering ? KEY_TIMEOUT_BUSY : KEY_TIMEOUT );
+	if ( c != ERR ) {
+		key = c;
+		key_start = perf_trace_start();
+	}
 	switch ( c ) {
 		/************* Common keys ***********************/
 		case 'g': /* Toggle grid */
@@ -606,19 +1708,49 @@ loop:
 			}
 			goto refresh;
 		case 'a': /* Show Audio Ports */
-			if ( strcmp(PortsType,JACK_DEFAULT_AUDIO_TYPE) == 0 )
-				goto loop;
-
-			nj.windows[2].name = CON_NAME_A;
-			PortsType = JACK_DEFAULT_AUDIO_TYPE;
-			goto refresh;
+			if ( nj.ports_type != port_type_id(JACK_DEFAULT_AUDIO_TYPE) )
+				nj_set_type( &nj, port_type_id(JACK_DEFAULT_AUDIO_TYPE) );
+			goto loop;
 		case 'm': /* Show MIDI Ports */
-			if ( strcmp(PortsType,JACK_DEFAULT_MIDI_TYPE) == 0 )
-				goto loop;
-
-			nj.windows[2].name = CON_NAME_M;
-			PortsType = JACK_DEFAULT_MIDI_TYPE;
+			if ( nj.ports_type != port_type_id(JACK_DEFAULT_MIDI_TYPE) )
+				nj_set_type( &nj, port_type_id(JACK_DEFAULT_MIDI_TYPE) );
+			goto loop;
+		case 'A': /* Show all port types */
+			if ( nj.ports_type != PORT_TYPE_ALL )
+				nj_set_type( &nj, PORT_TYPE_ALL );
+			goto loop;
+		case 't': /* Show next port type */
+			nj_cycle_type( &nj, 1 );
+			goto loop;
+		case 'T': /* Show previous port type */
+			nj_cycle_type( &nj, -1 );
+			goto loop;
+		case 'x': /* Xrun history */
+			show_xruns( &nj );
 			goto refresh;
+		case 'M': /* Level meters */
+			if ( nj.metering ) {
+				nj_meter_stop( &nj );
+			} else {
+				nj_meter_start( &nj );
+			}
+			goto loop;
+		case 'f': /* Trace signal flow */
+			nj.tracing = ! nj.tracing;
+			bitset_clear_all( &nj.marks );
+			nj.marked_out = nj.marked_in = NULL;
+			nj.need_mark = true;
+			nj.windows[0].redraw = nj.windows[1].redraw = true;
+			goto loop;
+		case 'e': /* Latency */
+			nj_show_latency( &nj, ! nj.show_latency );
+			goto loop;
+		case 'L': /* DSP load history */
+			nj.load_window = (nj.load_window + 1) % nj.load_window_count;
+			goto loop;
+		case 'p': /* Debug overlay, not in help */
+			nj_show_debug( &nj, ! nj.show_debug );
+			goto loop;
 		case 'q': /* Quit from app */
 		case KEY_EXIT: 
 			ret =0;
@@ -652,39 +1784,55 @@ loop:
 		case 'c': /* Connect */
 		case '\n':
 		case KEY_ENTER:
-			if ( nj_connect(&nj) )
-				goto refresh;
-			
-			nj.err_msg = ERR_CONNECT;
+			if ( ! nj_connect(&nj) )
+				nj.err_msg = ERR_CONNECT;
 			goto loop;
 		case 'd': /* Disconnect */
 		case KEY_BACKSPACE:
-			if ( nj_disconnect(&nj ) )
-				goto refresh;
-
-			nj.err_msg = ERR_DISCONNECT;
+			if ( ! nj_disconnect(&nj) )
+				nj.err_msg = ERR_DISCONNECT;
 			goto loop;
 		case 'D': /* Disconnect all */
 			if ( ! nj_disconnect_all(&nj) )
 				nj.err_msg = ERR_DISCONNECT;
-
-			goto refresh;
+			goto loop;
 		case 'j': /* Select next item on list */
 		case KEY_DOWN:
-			w_item_next( selected_window );
-			nj_set_redraw( &nj );
-			goto loop;
 		case KEY_UP: /* Select previous item on list */
 		case 'k':
-			w_item_previous( selected_window );
+		case KEY_NPAGE: /* Move one page */
+		case KEY_PPAGE:
+			nj_drain_nav_keys( &nj, selected_window, c );
 			nj_set_redraw( &nj );
 			goto loop;
+		case ']': /* Jump to next client */
+			w_item_next_client( selected_window );
+			nj_set_redraw( &nj );
+			goto loop;
+		case '[': /* Jump to previous client */
+			w_item_previous_client( selected_window );
+			nj_set_redraw( &nj );
+			goto loop;
+		case 's': /* Toggle item selection */
+			w_sel_toggle( selected_window );
+			w_item_next( selected_window );
+			nj_set_redraw( &nj );
+			goto loop;
+		case 'S': /* Select range */
+			w_sel_range( selected_window );
+			goto loop;
+		case 'C': /* Select all items of current client */
+			nj_select_client( &nj );
+			goto loop;
+		case 'u': /* Clear selection */
+			nj_select_clear( &nj );
+			goto loop;
 		case KEY_HOME: /* Select first item on list */
 			selected_window->index = 0;
 			nj_set_redraw( &nj );
 			goto loop;
 		case KEY_END: /* Select last item on list */
-			selected_window->index = selected_window->count - 1;
+			w_item_last( selected_window );
 			nj_set_redraw( &nj );
 			goto loop;
 		case 'h': /* Select left window */
@@ -700,24 +1848,37 @@ loop:
 			goto loop;
 	}
 
-	if (! nj.want_refresh) goto loop;
+	goto loop;
 refresh:
-	nj.want_refresh = false;
-	if ( ViewMode == VIEW_MODE_GRID )
-		nj.grid_redraw = true;
-
-	free_connections( nj.windows[2].list );
-	free_all_ports(all_ports_list);
-	w_cleanup(nj.windows); /* Clean windows lists */
-
-	goto lists;
+	/* Current generation stays on screen until rebuilt one arrives */
+	nj_redraw_all( &nj );
+	nj_request_build( &nj );
+	goto loop;
 quit:
-	free_connections( nj.windows[2].list );
-	free_all_ports(all_ports_list);
+	pthread_mutex_lock( &nj.build_lock );
+	nj.quit = true;
+	pthread_cond_signal( &nj.build_cond );
+	pthread_mutex_unlock( &nj.build_lock );
+	pthread_join( nj.builder, NULL );
+	atomic_store( &nj.sampling, false );
+	pthread_join( nj.sampler, NULL );
+	if ( nj.metering ) meter_stop( &nj.meters, nj.client );
+
 	w_cleanup(nj.windows); /* Clean windows lists */
+	graph_unref( atomic_exchange(&nj.pending, NULL) );
+	graph_unref( nj.graph );
+	graph_free_spare();
+	arena_free( &nj.build_scratch );
+	free_graph_diff( &nj.diff );
+	bitset_free( &nj.marks );
+	trace_free( &nj.trace );
+	if ( nj.perf_window ) delwin( nj.perf_window );
 	jack_deactivate( nj.client );
 	jack_client_close( nj.client );
+	close( nj.wake[0] );
+	close( nj.wake[1] );
 qxit:
 	endwin();
+	perf_trace_close();
 	return ret;
 }
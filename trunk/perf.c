@@ -0,0 +1,267 @@
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+#include "perf.h"
+
+typedef struct {
+	atomic_ullong last;  /* nsecs */
+	atomic_ullong total;
+	atomic_uint count;
+} PerfStat;
+
+typedef struct {
+	const char* name;
+	unsigned long long start;
+	unsigned long long end;
+	unsigned int arg;
+	char phase; /* 'X' span, 'i' instant */
+} TraceEvent;
+
+/* Owned by one thread, read only after all of them stopped */
+typedef struct {
+	long tid;
+	const char* name;
+	unsigned int count;
+	unsigned int dropped;
+	TraceEvent* events;
+} TraceBuffer;
+
+atomic_bool perf_on = false;
+atomic_bool perf_tracing = false;
+static bool timers;
+static PerfStat stats[PERF_TIMERS];
+
+/* UI thread only */
+static int io_fd = -1; /* -2 when counters are not available */
+static PerfIo frame_last, frame_total;
+static unsigned int frame_count;
+
+static FILE* trace_file;
+static unsigned long long trace_base;
+static TraceBuffer trace_buffers[PERF_TRACE_THREADS];
+static atomic_uint trace_claimed;
+static _Thread_local TraceBuffer* trace_own;
+static _Thread_local bool trace_none; /* all buffers were taken */
+
+static const char* names[PERF_TIMERS] = {
+	"build_ports",
+	"build_connections",
+	"select_ports",
+	"nj_mark_ports",
+	"w_draw outputs",
+	"w_draw inputs",
+	"w_draw connections",
+	"nj_draw_grid",
+	"frame",
+	"event to screen",
+};
+
+unsigned long long perf_now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void stat_add(enum PerfTimer t, unsigned long long ns) {
+	PerfStat* s = stats + t;
+	atomic_store_explicit(&s->last, ns, memory_order_relaxed);
+	atomic_fetch_add_explicit(&s->total, ns, memory_order_relaxed);
+	atomic_fetch_add_explicit(&s->count, 1, memory_order_relaxed);
+}
+
+/* Timed sections run in UI and builder thread */
+void perf_record(enum PerfTimer t, unsigned long long start, unsigned long long end) {
+	if (atomic_load_explicit(&perf_tracing, memory_order_relaxed))
+		perf_trace_add('X', names[t], start, end, 0);
+	stat_add(t, end - start);
+}
+
+/* Averages start over each time timers are switched on */
+void perf_enable(bool on) {
+	unsigned int i;
+	if (on) {
+		for (i = 0; i < PERF_TIMERS; i++) {
+			atomic_store(&stats[i].last, 0);
+			atomic_store(&stats[i].total, 0);
+			atomic_store(&stats[i].count, 0);
+		}
+		memset(&frame_last, 0, sizeof(PerfIo));
+		memset(&frame_total, 0, sizeof(PerfIo));
+		frame_count = 0;
+	}
+	timers = on;
+	atomic_store(&perf_on, timers || trace_file);
+}
+
+/* Output counters of calling thread, so writes of Jack threads do not
+ * count. Linux only, false elsewhere. Must be called from UI thread */
+bool perf_io(PerfIo* io) {
+	char buf[256];
+	char* s;
+	ssize_t n;
+
+	if (io_fd == -1) {
+		io_fd = open("/proc/thread-self/io", O_RDONLY);
+		if (io_fd < 0) io_fd = -2;
+	}
+	if (io_fd < 0 || (n = pread(io_fd, buf, sizeof(buf) - 1, 0)) <= 0)
+		return false;
+	buf[n] = '\0';
+
+	if (! (s = strstr(buf, "wchar:"))) return false;
+	io->bytes = strtoull(s + 6, NULL, 10);
+	if (! (s = strstr(buf, "syscw:"))) return false;
+	io->writes = strtoull(s + 6, NULL, 10);
+	return true;
+}
+
+/* Frame is one pass of drawing, it counts when it wrote to terminal */
+void perf_frame(unsigned long long start, const PerfIo* before) {
+	unsigned long long end = perf_now();
+	PerfIo io = { 0, 0 };
+
+	if (perf_io(&io)) {
+		io.bytes -= before->bytes;
+		io.writes -= before->writes;
+	}
+	if (atomic_load_explicit(&perf_tracing, memory_order_relaxed))
+		perf_trace_add('X', names[PERF_FRAME], start, end, io.bytes);
+	if (! io.bytes) return;
+
+	stat_add(PERF_FRAME, end - start);
+	frame_last = io;
+	frame_total.bytes += io.bytes;
+	frame_total.writes += io.writes;
+	frame_count++;
+}
+
+void perf_frames(PerfFrames* f) {
+	f->last = frame_last;
+	f->count = frame_count;
+	f->avg_bytes = frame_count ? (double) frame_total.bytes / frame_count : 0;
+	f->avg_writes = frame_count ? (double) frame_total.writes / frame_count : 0;
+}
+
+const char* perf_name(enum PerfTimer t) {
+	return names[t];
+}
+
+void perf_get(enum PerfTimer t, double* last_ms, double* avg_ms) {
+	PerfStat* s = stats + t;
+	unsigned int count = atomic_load_explicit(&s->count, memory_order_relaxed);
+
+	*last_ms = atomic_load_explicit(&s->last, memory_order_relaxed) / 1e6;
+	*avg_ms = count ? atomic_load_explicit(&s->total, memory_order_relaxed) / 1e6 / count : 0;
+}
+
+/* Buffers are allocated up front, recording thread never allocates.
+ * File is opened here so bad path is reported before UI starts */
+bool perf_trace_open(const char* path) {
+	unsigned int i;
+
+	trace_file = fopen(path, "w");
+	if (! trace_file) return false;
+
+	for (i = 0; i < PERF_TRACE_THREADS; i++) {
+		trace_buffers[i].events = calloc(PERF_TRACE_EVENTS, sizeof(TraceEvent));
+		if (! trace_buffers[i].events) {
+			while (i-- > 0) free(trace_buffers[i].events);
+			fclose(trace_file);
+			trace_file = NULL;
+			return false;
+		}
+	}
+	trace_base = perf_now();
+	atomic_store(&perf_tracing, true);
+	atomic_store(&perf_on, true);
+	return true;
+}
+
+static TraceBuffer* trace_buffer(void) {
+	if (trace_own || trace_none) return trace_own;
+
+	unsigned int i = atomic_fetch_add(&trace_claimed, 1);
+	if (i >= PERF_TRACE_THREADS) {
+		trace_none = true;
+		return NULL;
+	}
+	trace_own = trace_buffers + i;
+	trace_own->tid = syscall(SYS_gettid);
+	/* Fault pages in now, recording does not stall on them later and
+	 * memory of process does not grow while trace runs */
+	memset(trace_own->events, 0, PERF_TRACE_EVENTS * sizeof(TraceEvent));
+	return trace_own;
+}
+
+void perf_trace_thread(const char* name) {
+	TraceBuffer* b;
+	if (atomic_load(&perf_tracing) && (b = trace_buffer()))
+		b->name = name;
+}
+
+void perf_trace_add(char phase, const char* name, unsigned long long start,
+		unsigned long long end, unsigned int arg) {
+	TraceBuffer* b = trace_buffer();
+	if (! b) return;
+	if (b->count == PERF_TRACE_EVENTS) {
+		b->dropped++;
+		return;
+	}
+
+	TraceEvent* e = b->events + b->count++;
+	e->name = name;
+	e->start = start;
+	e->end = end;
+	e->arg = arg;
+	e->phase = phase;
+}
+
+/* Write Chrome trace JSON, every recording thread must have stopped */
+void perf_trace_close(void) {
+	unsigned int i, j, n;
+	const char* sep = "";
+	long pid = getpid();
+
+	if (! trace_file) return;
+	atomic_store(&perf_tracing, false);
+	atomic_store(&perf_on, timers);
+
+	n = atomic_load(&trace_claimed);
+	if (n > PERF_TRACE_THREADS) n = PERF_TRACE_THREADS;
+
+	fprintf(trace_file, "{\"traceEvents\":[");
+	for (i = 0; i < n; i++) {
+		TraceBuffer* b = trace_buffers + i;
+
+		if (b->name) {
+			fprintf(trace_file, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%ld,"
+				"\"tid\":%ld,\"args\":{\"name\":\"%s\"}}", sep, pid, b->tid, b->name);
+			sep = ",";
+		}
+		for (j = 0; j < b->count; j++) {
+			TraceEvent* e = b->events + j;
+
+			fprintf(trace_file, "%s\n{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%.3f,",
+				sep, e->name, e->phase, (e->start - trace_base) / 1e3);
+			if (e->phase == 'X')
+				fprintf(trace_file, "\"dur\":%.3f,", (e->end - e->start) / 1e3);
+			else
+				fprintf(trace_file, "\"s\":\"t\",");
+			fprintf(trace_file, "\"pid\":%ld,\"tid\":%ld,\"args\":{\"arg\":%u}}",
+				pid, b->tid, e->arg);
+			sep = ",";
+		}
+		if (b->dropped)
+			fprintf(stderr, "Trace: %u events of thread %ld dropped\n", b->dropped, b->tid);
+	}
+	fprintf(trace_file, "\n],\"displayTimeUnit\":\"ms\"}\n");
+	for (i = 0; i < PERF_TRACE_THREADS; i++)
+		free(trace_buffers[i].events);
+	fclose(trace_file);
+	trace_file = NULL;
+}
@@ -0,0 +1,80 @@
+#ifndef PERF_H
+#define PERF_H
+
+#include <stdbool.h>
+#include <stdatomic.h>
+
+enum PerfTimer {
+	PERF_BUILD_PORTS,
+	PERF_BUILD_CONNECTIONS,
+	PERF_SELECT_PORTS,
+	PERF_MARK_PORTS,
+	PERF_DRAW_OUT,
+	PERF_DRAW_IN,
+	PERF_DRAW_CON,
+	PERF_DRAW_GRID,
+	PERF_FRAME,
+	PERF_EVENT,
+	PERF_TIMERS
+};
+
+/* Terminal output of UI thread */
+typedef struct {
+	unsigned long long bytes;
+	unsigned long long writes; /* write syscalls */
+} PerfIo;
+
+/* Frames which wrote to terminal, averages since timers were switched on */
+typedef struct {
+	PerfIo last;
+	double avg_bytes;
+	double avg_writes;
+	unsigned int count;
+} PerfFrames;
+
+#define PERF_TRACE_THREADS 8      /* buffers, threads beyond get none */
+#define PERF_TRACE_EVENTS 65536   /* per thread, later events are dropped */
+
+/* Timers run only while overlay is shown or trace is recorded,
+ * otherwise a timed section costs one relaxed load */
+extern atomic_bool perf_on;
+extern atomic_bool perf_tracing;
+
+unsigned long long perf_now(void);
+void perf_record(enum PerfTimer t, unsigned long long start, unsigned long long end);
+void perf_enable(bool on);
+const char* perf_name(enum PerfTimer t);
+void perf_get(enum PerfTimer t, double* last_ms, double* avg_ms);
+bool perf_io(PerfIo* io);
+void perf_frame(unsigned long long start, const PerfIo* before);
+void perf_frames(PerfFrames* f);
+
+bool perf_trace_open(const char* path);
+void perf_trace_thread(const char* name);
+void perf_trace_add(char phase, const char* name, unsigned long long start,
+	unsigned long long end, unsigned int arg);
+void perf_trace_close(void);
+
+static inline unsigned long long perf_start(void) {
+	return atomic_load_explicit(&perf_on, memory_order_relaxed) ? perf_now() : 0;
+}
+
+static inline void perf_stop(enum PerfTimer t, unsigned long long start) {
+	if (start) perf_record(t, start, perf_now());
+}
+
+/* Trace only spans and instants, name must be static string */
+static inline unsigned long long perf_trace_start(void) {
+	return atomic_load_explicit(&perf_tracing, memory_order_relaxed) ? perf_now() : 0;
+}
+
+static inline void perf_trace_span(const char* name, unsigned long long start, unsigned int arg) {
+	if (start) perf_trace_add('X', name, start, perf_now(), arg);
+}
+
+static inline void perf_trace_mark(const char* name, unsigned int arg) {
+	if (atomic_load_explicit(&perf_tracing, memory_order_relaxed))
+		perf_trace_add('i', name, perf_now(), 0, arg);
+}
+
+#endif /* PERF_H */
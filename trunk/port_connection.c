@@ -1,107 +1,1245 @@
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <pthread.h>
+
+#include <jack/uuid.h>
 
 #include "port_connection.h"
+#include "perf.h"
 
-/* CONNECTIONS */
-JSList* build_connections(jack_client_t* client, JSList* list, const char* type) {
-	JSList* new = NULL;
+/* FNV-1a */
+#define HASH_INIT 2166136261u
+
+static unsigned int hash_bytes(unsigned int h, const char* s, size_t len) {
+	while (len--) {
+		h ^= (unsigned char) *s++;
+		h *= 16777619u;
+	}
+	return h;
+}
+
+/* Hash of full "client:port" name */
+static unsigned int hash_port(Graph* g, Port* p) {
+	Client* c = g->clients + p->client;
+	unsigned int h = hash_bytes(HASH_INIT, g->names + c->name, c->name_len);
+	h = hash_bytes(h, ":", 1);
+	return hash_bytes(h, g->names + p->name, p->name_len);
+}
+
+static bool port_name_equal(Graph* g, Port* p, const char* name) {
+	Client* c = g->clients + p->client;
+	return strncmp(name, g->names + c->name, c->name_len) == 0 &&
+		name[c->name_len] == ':' &&
+		strcmp(name + c->name_len + 1, g->names + p->name) == 0;
+}
+
+/* Open addressing table of index + 1, zero is empty slot */
+typedef struct {
+	unsigned int* slot;
+	unsigned int mask;
+} HashIndex;
+
+static void hash_index_init(HashIndex* idx, unsigned int count, Arena* a) {
+	unsigned int size = 2;
+	while (size < 2 * count) size <<= 1;
+
+	idx->slot = arena_calloc(a, size * sizeof(unsigned int));
+	idx->mask = size - 1;
+}
+
+/* PORT TYPES */
+/* Ids stay valid for whole program life, so views can keep them.
+ * Builder thread adds types while UI reads them, so all access is
+ * under lock; names are never freed once handed out */
+static pthread_mutex_t port_types_lock = PTHREAD_MUTEX_INITIALIZER;
+static char** port_types = NULL;
+static char* port_types_tag = NULL;
+static unsigned short port_types_count = 0;
+
+/* Marker is first letter of last word: "32 bit float mono audio" -> A */
+static char type_tag(const char* type) {
+	const char* s = strrchr(type, ' ');
+	s = s ? s + 1 : type;
+	return (*s >= 'a' && *s <= 'z') ? *s - 'a' + 'A' : (*s ? *s : '?');
+}
+
+unsigned short port_type_id(const char* type) {
+	unsigned short i;
+
+	pthread_mutex_lock(&port_types_lock);
+	for (i = 0; i < port_types_count; i++)
+		if (strcmp(port_types[i], type) == 0) goto out;
+
+	port_types = realloc(port_types, (port_types_count + 1) * sizeof(char*));
+	port_types_tag = realloc(port_types_tag, port_types_count + 1);
+	port_types[port_types_count] = strdup(type);
+	port_types_tag[port_types_count] = type_tag(type);
+	port_types_count++;
+out:
+	pthread_mutex_unlock(&port_types_lock);
+	return i;
+}
+
+unsigned short port_type_count(void) {
+	unsigned short ret;
+	pthread_mutex_lock(&port_types_lock);
+	ret = port_types_count;
+	pthread_mutex_unlock(&port_types_lock);
+	return ret;
+}
+
+const char* port_type_name(unsigned short id) {
+	const char* ret;
+	pthread_mutex_lock(&port_types_lock);
+	ret = (id < port_types_count) ? port_types[id] : "";
+	pthread_mutex_unlock(&port_types_lock);
+	return ret;
+}
+
+/* Markers of types generation knows, copied once so drawing reads
+ * them without lock */
+static void copy_type_tags(Graph* g) {
+	g->type_tags = arena_alloc(&g->arena, g->type_count + 1);
+	pthread_mutex_lock(&port_types_lock);
+	if (g->type_count) memcpy(g->type_tags, port_types_tag, g->type_count);
+	pthread_mutex_unlock(&port_types_lock);
+}
+
+char port_type_tag(Graph* g, unsigned short id) {
+	return (id < g->type_count) ? g->type_tags[id] : '?';
+}
+
+/* NAMES */
+const char* port_name(Graph* g, Port* p) {
+	return g->names + p->name;
+}
+
+const char* port_client_name(Graph* g, Port* p) {
+	return g->names + g->clients[p->client].name;
+}
 
-	JSList* node;
-	for ( node=list; node; node=jack_slist_next(node) ) {
-		// For all Input ports
-		Port *inp = node->data;
-		if(! (inp->flags & JackPortIsInput)) continue;
-		if( strcmp(inp->type, type) != 0 ) continue;
+/* Length of full name */
+unsigned int port_name_len(Graph* g, Port* p) {
+	return g->clients[p->client].name_len + 1 + p->name_len;
+}
 
-		const char** connections = jack_port_get_all_connections (
-				client, jack_port_by_name(client, inp->name) );
-		if (!connections) continue;
+static unsigned int names_add(Graph* g, const char* s, size_t len) {
+	unsigned int ret = g->names_size;
+	memcpy(g->names + ret, s, len);
+	g->names[ret + len] = '\0';
+	g->names_size += len + 1;
+	return ret;
+}
 
-		unsigned short i;
-		for (i=0; connections[i]; i++) {
-			Port *outp = get_port_by_name(list, connections[i]);
-			if(!outp) continue; // WTF can't find OutPort in our list ?
+static bool client_equal(Graph* g, Client* c, const char* name, size_t len) {
+	return c->name_len == len && strncmp(g->names + c->name, name, len) == 0;
+}
 
-			Connection* c = malloc(sizeof(Connection));
-			c->type = type;
-			c->in = inp;
-			c->out = outp;
-			new = jack_slist_append(new, c);
+/* Without index (single port registered later) clients are scanned */
+static unsigned int intern_client(Graph* g, HashIndex* idx, const char* name, size_t len) {
+	unsigned int h = 0;
+	if (idx) {
+		h = hash_bytes(HASH_INIT, name, len) & idx->mask;
+		for (; idx->slot[h]; h = (h + 1) & idx->mask) {
+			if (client_equal(g, g->clients + idx->slot[h] - 1, name, len))
+				return idx->slot[h] - 1;
+		}
+	} else {
+		for (h = 0; h < g->client_count; h++) {
+			if (client_equal(g, g->clients + h, name, len))
+				return h;
 		}
-		jack_free(connections);
 	}
 
-	return new;
+	/* New client */
+	unsigned int n = g->client_count++;
+	if ((n & (n - 1)) == 0) /* grow on powers of two */
+		g->clients = arena_realloc(&g->arena, g->clients, n * sizeof(Client),
+			2 * (n + 1) * sizeof(Client));
+
+	g->clients[n].name = names_add(g, name, len);
+	g->clients[n].name_len = len;
+	if (idx) idx->slot[h] = n + 1;
+	return n;
+}
+
+/* Jack API takes full port names */
+static void port_full_name(Graph* g, Port* p, char* buf, size_t size) {
+	snprintf(buf, size, "%s:%s", port_client_name(g, p), port_name(g, p));
+}
+
+int port_connect(jack_client_t* client, Graph* g, Port* out, Port* in) {
+	int size = jack_port_name_size();
+	char src[size], dst[size];
+
+	port_full_name(g, out, src, size);
+	port_full_name(g, in, dst, size);
+	return jack_connect(client, src, dst);
+}
+
+int port_disconnect(jack_client_t* client, Graph* g, Port* out, Port* in) {
+	int size = jack_port_name_size();
+	char src[size], dst[size];
+
+	port_full_name(g, out, src, size);
+	port_full_name(g, in, dst, size);
+	return jack_disconnect(client, src, dst);
+}
+
+/* CONNECTIONS */
+void build_connections(jack_client_t* client, Graph* g, Arena* scratch) {
+	unsigned int i, j, cap = 64;
+	unsigned short t;
+
+	g->cons = arena_alloc(&g->arena, cap * sizeof(Connection));
+	g->con_count = 0;
+	g->con_ranges = arena_calloc(&g->arena, (g->type_count + 1) * sizeof(Range));
+
+	/* Full name lookups of connected ports */
+	HashIndex idx;
+	hash_index_init(&idx, g->count, scratch);
+	for (i = 0; i < g->count; i++) {
+		unsigned int h = hash_port(g, g->ports + i) & idx.mask;
+		while (idx.slot[h]) h = (h + 1) & idx.mask;
+		idx.slot[h] = i + 1;
+	}
+
+	/* Ports are partitioned by type, so connections come out partitioned
+	 * too. Each connection is seen from both ends, so query only the
+	 * side with fewer ports of each type */
+	for (t = 0; t < g->type_count; t++) {
+		Range ro = select_ports(g, JackPortIsOutput, t);
+		Range r = select_ports(g, JackPortIsInput, t);
+		bool from_out = ro.count < r.count;
+		if (from_out) r = ro;
+		g->con_ranges[t].start = g->con_count;
+
+		for (i = r.start; i < r.start + r.count; i++) {
+			Port *port = g->ports + i;
+
+			const char** connections = jack_port_get_all_connections (
+					client, port->jport );
+			g->jack_calls++;
+			if (!connections) continue;
+
+			for (j=0; connections[j]; j++) {
+				Port *peer = NULL;
+				unsigned int h = hash_bytes(HASH_INIT, connections[j],
+					strlen(connections[j])) & idx.mask;
+				for (; idx.slot[h]; h = (h + 1) & idx.mask) {
+					Port* p = g->ports + idx.slot[h] - 1;
+					if (port_name_equal(g, p, connections[j])) {
+						peer = p;
+						break;
+					}
+				}
+				if(!peer) continue; // WTF can't find peer in our list ?
+
+				if (g->con_count == cap) {
+					g->cons = arena_realloc(&g->arena, g->cons,
+						cap * sizeof(Connection), 2 * cap * sizeof(Connection));
+					cap *= 2;
+				}
+				Connection* c = g->cons + g->con_count++;
+				c->type = t;
+				c->in = from_out ? peer : port;
+				c->out = from_out ? port : peer;
+			}
+			jack_free(connections);
+		}
+		g->con_ranges[t].count = g->con_count - g->con_ranges[t].start;
+	}
 }
 
-void free_connections( JSList* list_con ) {
-	JSList* node;
-	for ( node=list_con; node; node=jack_slist_next(node) )
-		free(node->data);
+Range select_connections(Graph* g, unsigned short type) {
+	Range none = { 0, 0 };
+	if (type == PORT_TYPE_ALL) {
+		Range all = { 0, g->con_count };
+		return all;
+	}
+	return (type < g->type_count) ? g->con_ranges[type] : none;
 }
 
 /* PORTS */
-JSList* build_ports(jack_client_t* client) {
-	unsigned short i, count=0;
+/* Table of server port id -> index + 1, port ids are small indexes */
+static void build_id_index(Graph* g) {
+	unsigned int i, size = 0;
+
+	for (i = 0; i < g->count; i++) {
+		if (jack_uuid_empty(g->ports[i].uuid)) continue;
+		jack_port_id_t id = jack_uuid_to_index(g->ports[i].uuid);
+		if (id >= size) size = id + 1;
+	}
+
+	g->by_id = arena_calloc(&g->arena, (size + 1) * sizeof(unsigned int));
+	g->id_count = size;
+	for (i = 0; i < g->count; i++) {
+		if (jack_uuid_empty(g->ports[i].uuid)) continue;
+		g->by_id[jack_uuid_to_index(g->ports[i].uuid)] = i + 1;
+	}
+}
+
+/* Latency on the side of port which faces away from its connections:
+ * since capture for output, until playback for input */
+static void port_read_latency(Port* p) {
+	jack_latency_range_t r;
+	jack_port_get_latency_range(p->jport,
+		(p->flags & JackPortIsOutput) ? JackCaptureLatency : JackPlaybackLatency, &r);
+	p->latency = r.max;
+	p->path_stale = true;
+}
+
+/* Outputs go first, each direction partitioned by type */
+static unsigned int port_bucket(unsigned short type, unsigned char flags, unsigned short type_count) {
+	return ((flags & JackPortIsInput) ? type_count : 0) + type;
+}
+
+void build_ports(jack_client_t* client, Graph* g, Arena* scratch) {
+	unsigned int i, count=0;
+	size_t names_size = 0;
 
 	const char** jports = jack_get_ports (client, NULL, NULL, 0);
-	if(! jports) return NULL;
+	g->jack_calls = 1;
+	if(! jports) {
+		/* Empty graph still owns its tables */
+		g->ranges = arena_calloc(&g->arena, sizeof(Range));
+		g->by_id = arena_calloc(&g->arena, sizeof(unsigned int));
+		g->names = arena_calloc(&g->arena, 1);
+		return;
+	}
 
-	while(jports[count]) count++;
-	Port* p = calloc(count, sizeof(Port));
+	for (count=0; jports[count]; count++)
+		names_size += strlen(jports[count]) + 1;
 
-	JSList* new = NULL;
-	for (i=0; jports[i]; ++i, p++) {
+	/* Type and direction first, to know where each port goes.
+	 * Handles are kept, so nothing is looked up by name again.
+	 * Ports unregistered since list was taken are left out, their
+	 * events are still queued and find them missing */
+	jack_port_t** handles = arena_alloc(scratch, count * sizeof(jack_port_t*));
+	unsigned short* types = arena_alloc(scratch, count * sizeof(unsigned short));
+	unsigned char* flags = arena_alloc(scratch, count);
+	const char** names = arena_alloc(scratch, count * sizeof(char*));
+	unsigned int listed = count;
+	for (i=0, count=0; i < listed; ++i) {
 		jack_port_t* jp = jack_port_by_name( client, jports[i] );
+		const char* type = jp ? jack_port_type( jp ) : NULL;
+		if (! type) continue;
+		names[count] = jports[i];
+		handles[count] = jp;
+		types[count] = port_type_id( type );
+		flags[count] = jack_port_flags( jp );
+		count++;
+	}
+	g->jack_calls += listed;
+
+	/* Counting sort keeps server order inside each partition */
+	g->type_count = port_type_count();
+	copy_type_tags(g);
+	g->ranges = arena_calloc(&g->arena, (2 * g->type_count + 1) * sizeof(Range));
+	for (i=0; i < count; ++i)
+		g->ranges[port_bucket(types[i], flags[i], g->type_count)].count++;
 
-		strncpy(p->name, jports[i], sizeof(p->name));
-		strncpy(p->type, jack_port_type( jp ), sizeof(p->type));
-		p->flags = jack_port_flags( jp );
-		new = jack_slist_append(new, p);
+	unsigned int b, start = 0;
+	for (b = 0; b < 2 * g->type_count; b++) {
+		g->ranges[b].start = start;
+		start += g->ranges[b].count;
 	}
+
+	/* Interned client names and short port names always fit
+	 * in size of full names */
+	g->ports = arena_calloc(&g->arena, count * sizeof(Port));
+	g->names = arena_alloc(&g->arena, names_size);
+
+	HashIndex idx;
+	hash_index_init(&idx, count, scratch);
+
+	unsigned int* fill = arena_calloc(scratch, (2 * g->type_count + 1) * sizeof(unsigned int));
+	for (i=0; i < count; ++i) {
+		b = port_bucket(types[i], flags[i], g->type_count);
+		Port* p = g->ports + g->ranges[b].start + fill[b]++;
+
+		size_t client_len = strcspn(names[i], ":");
+		const char* short_name = names[i] + client_len;
+		if (*short_name) short_name++;
+
+		p->client = intern_client(g, &idx, names[i], client_len);
+		p->name_len = strlen(short_name);
+		p->name = names_add(g, short_name, p->name_len);
+		p->jport = handles[i];
+		p->uuid = jack_port_uuid(handles[i]);
+		p->type = types[i];
+		p->flags = flags[i];
+		port_read_latency(p);
+	}
+	g->count = count;
+	g->paths_stale = true;
+	build_id_index(g);
+
 	jack_free(jports);
+}
+
+/* Ports of one direction and type, a slice of ports table */
+Range select_ports(Graph* g, int flags, unsigned short type) {
+	Range none = { 0, 0 };
+	if (type == PORT_TYPE_ALL) {
+		/* Type partitions of one direction are adjacent */
+		Range all = { 0, g->type_count ? g->ranges[g->type_count].start : g->count };
+		if (flags & JackPortIsInput) {
+			all.start = all.count;
+			all.count = g->count - all.start;
+		}
+		return all;
+	}
+	if (type >= g->type_count) return none;
+	return g->ranges[port_bucket(type, flags, g->type_count)];
+}
+
+Port* get_port_by_id(Graph* g, jack_port_id_t id) {
+	if (id >= g->id_count || ! g->by_id[id]) return NULL;
+	return g->ports + g->by_id[id] - 1;
+}
+
+/* Connections point into ports table, follow it when it moves.
+ * Ports from pos on are shifted by shift places */
+static void rebase_connections(Graph* g, Port* old, unsigned int pos, int shift) {
+	unsigned int i;
+	for (i = 0; i < g->con_count; i++) {
+		Connection* c = g->cons + i;
+		unsigned int in = c->in - old, out = c->out - old;
+		c->in = g->ports + in + (in >= pos ? shift : 0);
+		c->out = g->ports + out + (out >= pos ? shift : 0);
+	}
+}
+
+static void remove_connection(Graph* g, unsigned int k) {
+	unsigned short t = g->cons[k].type;
+	memmove(g->cons + k, g->cons + k + 1, (g->con_count - k - 1) * sizeof(Connection));
+	g->con_count--;
+	g->con_ranges[t].count--;
+	for (t++; t < g->type_count; t++)
+		g->con_ranges[t].start--;
+}
+
+typedef struct {
+	jack_port_t* jport;
+	const char* name;
+	unsigned short type;
+	unsigned char flags;
+	unsigned int bucket;
+} NewPort;
+
+/* Port registered after last build, NULL when event is stale: port is
+ * gone again, known already, or its id was reused under other name */
+static bool new_port(jack_client_t* client, Graph* g, jack_port_id_t id, NewPort* n) {
+	jack_port_t* jp = jack_port_by_id(client, id);
+	g->jack_calls++;
+	if (! jp || get_port_by_id(g, id)) return false;
+
+	n->name = jack_port_name(jp);
+	const char* type_name = jack_port_type(jp);
+	g->jack_calls += 3;
+	if (! n->name || ! type_name || jack_port_by_name(client, n->name) != jp) return false;
+
+	n->jport = jp;
+	n->type = port_type_id(type_name);
+	n->flags = jack_port_flags(jp);
+	return true;
+}
+
+static int cmp_id(const void* a, const void* b) {
+	jack_port_id_t x = *(const jack_port_id_t*) a, y = *(const jack_port_id_t*) b;
+	return (x > y) - (x < y);
+}
+
+/* Ports registered after last build, added in one pass: each goes to
+ * end of its partition, table is copied and connections follow it once
+ * for all of them. Returns false when model has to be rebuilt instead
+ * (port of type not known to ports table) */
+bool graph_add_ports(jack_client_t* client, Graph* g, jack_port_id_t* ids, unsigned int count) {
+	unsigned int i, b, added = 0;
+	size_t names_size = 0;
 
-	return new;
+	g->jack_calls = 0;
+	qsort(ids, count, sizeof(jack_port_id_t), cmp_id);
+	NewPort* list = arena_alloc(&g->arena, count * sizeof(NewPort));
+	for (i = 0; i < count; i++) {
+		if (i && ids[i] == ids[i - 1]) continue;
+		NewPort* n = list + added;
+		if (! new_port(client, g, ids[i], n)) continue;
+		if (n->type >= g->type_count) return false;
+		n->bucket = port_bucket(n->type, n->flags, g->type_count);
+		names_size += strlen(n->name) + 2;
+		added++;
+	}
+	if (! added) return true;
+
+	/* Old bucket b moves by number of new ports in buckets before it */
+	unsigned int buckets = 2 * g->type_count;
+	unsigned int* grow = arena_calloc(&g->arena, (buckets + 1) * sizeof(unsigned int));
+	unsigned int* shift = arena_calloc(&g->arena, (buckets + 1) * sizeof(unsigned int));
+	for (i = 0; i < added; i++)
+		grow[list[i].bucket]++;
+	for (b = 1; b <= buckets; b++)
+		shift[b] = shift[b - 1] + grow[b - 1];
+
+	Port* old = g->ports;
+	g->ports = arena_alloc(&g->arena, (g->count + added) * sizeof(Port));
+	for (b = 0; b < buckets; b++) {
+		Range* r = g->ranges + b;
+		memcpy(g->ports + r->start + shift[b], old + r->start, r->count * sizeof(Port));
+		r->start += shift[b];
+	}
+
+	for (i = 0; i < g->con_count; i++) {
+		Connection* c = g->cons + i;
+		c->in = g->ports + (c->in - old) + shift[port_bucket(c->in->type, c->in->flags, g->type_count)];
+		c->out = g->ports + (c->out - old) + shift[port_bucket(c->out->type, c->out->flags, g->type_count)];
+	}
+
+	g->names = arena_realloc(&g->arena, g->names, g->names_size, g->names_size + names_size);
+	for (i = 0; i < added; i++) {
+		NewPort* n = list + i;
+		size_t client_len = strcspn(n->name, ":");
+		const char* short_name = n->name + client_len;
+		if (*short_name) short_name++;
+
+		Port* p = g->ports + g->ranges[n->bucket].start + g->ranges[n->bucket].count++;
+		memset(p, 0, sizeof(Port));
+		p->jport = n->jport;
+		p->uuid = jack_port_uuid(n->jport);
+		p->client = intern_client(g, NULL, n->name, client_len);
+		p->name_len = strlen(short_name);
+		p->name = names_add(g, short_name, p->name_len);
+		p->type = n->type;
+		p->flags = n->flags;
+		port_read_latency(p);
+	}
+	g->count += added;
+
+	build_id_index(g);
+	return true;
 }
 
-void free_all_ports(JSList* all_ports) {
-	/* First node is pointer to calloc-ed big chunk */
-	if (! all_ports) return;
-	free(all_ports->data);
-	jack_slist_free(all_ports);
+/* Ports unregistered, their connections go with them. Run of removals,
+ * as client leaving makes, compacts ports and connections once and keeps
+ * id index in place. Names stay in arena until next clone. Returns
+ * whether model changed */
+bool graph_remove_ports(Graph* g, jack_port_id_t* ids, unsigned int count) {
+	unsigned int* place = NULL; /* 1 for port going, then new index */
+	unsigned int i, j, b, removed = 0;
+	unsigned short t;
+
+	g->jack_calls = 0;
+	for (i = 0; i < count; i++) {
+		Port* p = get_port_by_id(g, ids[i]);
+		if (! p) continue; /* stale or repeated event */
+		if (! place) place = arena_calloc(&g->arena, g->count * sizeof(unsigned int));
+		place[p - g->ports] = 1;
+		g->by_id[ids[i]] = 0;
+		removed++;
+	}
+	if (! removed) return false;
+
+	for (i = j = 0; i < g->con_count; i++) {
+		Connection* c = g->cons + i;
+		if (place[c->in - g->ports] || place[c->out - g->ports]) {
+			c->in->path_stale = c->out->path_stale = true;
+			g->con_ranges[c->type].count--;
+			continue;
+		}
+		g->cons[j++] = *c;
+	}
+	g->con_count = j;
+	for (t = 1; t < g->type_count; t++)
+		g->con_ranges[t].start = g->con_ranges[t - 1].start + g->con_ranges[t - 1].count;
+
+	for (i = j = 0; i < g->count; i++) {
+		Port* p = g->ports + i;
+		if (place[i]) {
+			g->ranges[port_bucket(p->type, p->flags, g->type_count)].count--;
+			continue;
+		}
+		place[i] = j;
+		g->ports[j] = *p;
+		if (! jack_uuid_empty(p->uuid))
+			g->by_id[jack_uuid_to_index(p->uuid)] = j + 1;
+		j++;
+	}
+	g->count = j;
+	for (b = 1; b < 2 * g->type_count; b++)
+		g->ranges[b].start = g->ranges[b - 1].start + g->ranges[b - 1].count;
+
+	for (i = 0; i < g->con_count; i++) {
+		Connection* c = g->cons + i;
+		c->in = g->ports + place[c->in - g->ports];
+		c->out = g->ports + place[c->out - g->ports];
+	}
+	return true;
 }
 
-JSList*
-select_ports(JSList* list, int flags, const char* type) {
-	JSList* new = NULL;
-	JSList* node;
-	for ( node=list; node; node=jack_slist_next(node) ) {
-		Port* p = node->data;
-		if ( (p->flags & flags) && strcmp(p->type, type) == 0 )
-			new = jack_slist_append(new, p);
+/* Connection made on server, ports given in any order.
+ * Returns whether model changed */
+bool graph_connect(Graph* g, Port* a, Port* b) {
+	Port* out = (a->flags & JackPortIsOutput) ? a : b;
+	Port* in  = (a->flags & JackPortIsOutput) ? b : a;
+	unsigned short t = out->type;
+	Range r = g->con_ranges[t];
+	unsigned int i;
+
+	g->jack_calls = 0;
+	/* Ids of stale event may point to other ports now */
+	if (! (out->flags & JackPortIsOutput) || ! (in->flags & JackPortIsInput) || in->type != t)
+		return false;
+	for (i = r.start; i < r.start + r.count; i++) {
+		if (g->cons[i].out == out && g->cons[i].in == in)
+			return false; /* we made it ourself */
 	}
 
-	return new;
+	i = r.start + r.count;
+	g->cons = arena_realloc(&g->arena, g->cons, g->con_count * sizeof(Connection),
+		(g->con_count + 1) * sizeof(Connection));
+	memmove(g->cons + i + 1, g->cons + i, (g->con_count - i) * sizeof(Connection));
+	g->cons[i].type = t;
+	g->cons[i].in = in;
+	g->cons[i].out = out;
+	in->path_stale = out->path_stale = true;
+	g->con_count++;
+	g->con_ranges[t].count++;
+	for (t++; t < g->type_count; t++)
+		g->con_ranges[t].start++;
+	return true;
 }
 
-Port*
-get_port_by_name(JSList* list, const char* name) {
-	JSList* node;
+bool graph_disconnect(Graph* g, Port* a, Port* b) {
+	Range r = g->con_ranges[a->type];
+	unsigned int i;
 
-	for ( node=list; node; node=jack_slist_next(node) ) {
-		Port* p = node->data;
-		if (strcmp(p->name, name) == 0) return p;
+	g->jack_calls = 0;
+	for (i = r.start; i < r.start + r.count; i++) {
+		Connection* c = g->cons + i;
+		if ((c->out == a && c->in == b) || (c->out == b && c->in == a)) {
+			a->path_stale = b->path_stale = true;
+			remove_connection(g, i);
+			return true;
+		}
 	}
-	return NULL;
+	return false;
 }
 
-int get_max_port_name ( JSList* list ) {
+/* Latency callback came, ports of clone follow server again */
+void graph_read_latency(Graph* g) {
+	unsigned int i;
+	g->jack_calls = 0; /* ranges are kept by client library */
+	for (i = 0; i < g->count; i++)
+		port_read_latency(g->ports + i);
+	g->paths_stale = true;
+}
+
+int get_max_port_name ( Graph* g, Port* ports, unsigned int count ) {
 	int ret = 0;
-	JSList* node;
-	for ( node=list; node; node=jack_slist_next(node) ) {
-		Port* p = node->data;
-		int len = strlen ( p->name );
+	unsigned int i;
+	for ( i = 0; i < count; i++ ) {
+		int len = port_name_len ( g, ports + i );
 		if ( len > ret ) ret = len;
 	}
 	return ret;
 }
+
+/* ADJACENCY */
+void build_adjacency(Adjacency* adj, Graph* g) {
+	unsigned int i;
+
+	adj->base = g->ports;
+	adj->count = g->count;
+	adj->start = arena_calloc(&g->arena, (adj->count + 1) * sizeof(unsigned int));
+	adj->peer = NULL;
+
+	/* Port is either input or output, so both directions share one table */
+	for ( i=0; i < g->con_count; i++ ) {
+		Connection* c = g->cons + i;
+		adj->start[c->out - adj->base]++;
+		adj->start[c->in - adj->base]++;
+	}
+	if (g->con_count == 0) return;
+
+	/* Degrees to offsets: start[i] is end of port i peers until filled */
+	unsigned int sum = 0;
+	for (i = 0; i <= adj->count; i++) {
+		sum += adj->start[i];
+		adj->start[i] = sum;
+	}
+
+	adj->peer = arena_alloc(&g->arena, 2 * g->con_count * sizeof(Port*));
+	for ( i=0; i < g->con_count; i++ ) {
+		Connection* c = g->cons + i;
+		adj->peer[--adj->start[c->out - adj->base]] = c->in;
+		adj->peer[--adj->start[c->in - adj->base]] = c->out;
+	}
+}
+
+/* LATENCY */
+/* Own latency plus worst latency on other side of connections: capture
+ * reaching an input, playback after an output. Server keeps those
+ * totals along whole graph, so one hop gives end-to-end path */
+static jack_nframes_t path_latency(Graph* g, Port* p) {
+	Adjacency* adj = &g->adj;
+	unsigned int i = p - adj->base;
+	unsigned int j;
+	jack_nframes_t far = 0;
+
+	if (adj->peer) {
+		for (j = adj->start[i]; j < adj->start[i+1]; j++)
+			if (adj->peer[j]->latency > far) far = adj->peer[j]->latency;
+	}
+	return p->latency + far;
+}
+
+/* Clones recompute only ports their edits touched */
+static void update_paths(Graph* g) {
+	unsigned int i;
+	for (i = 0; i < g->count; i++) {
+		Port* p = g->ports + i;
+		if (! g->paths_stale && ! p->path_stale) continue;
+		p->path = path_latency(g, p);
+		p->path_stale = false;
+	}
+	g->paths_stale = false;
+}
+
+/* FLOW */
+/* Node of port in client level graph */
+static unsigned int flow_node(Graph* g, Port* p) {
+	if (! (p->flags & (JackPortIsPhysical | JackPortIsTerminal))) return p->client;
+	return ((p->flags & JackPortIsOutput) ? 1 : 2) * g->client_count + p->client;
+}
+
+/* Node edges of connections in both directions, counted into place */
+static void build_flow_edges(Graph* g) {
+	ClientFlow* f = &g->flow;
+	unsigned int i, n = 3 * g->client_count;
+	int dir;
+
+	f->node_count = n;
+
+	for (dir = FLOW_DOWN; dir <= FLOW_UP; dir++) {
+		unsigned int* start = arena_calloc(&g->arena, (n + 2) * sizeof(unsigned int));
+		unsigned int* next = arena_alloc(&g->arena, (g->con_count + 1) * sizeof(unsigned int));
+		for (i = 0; i < g->con_count; i++) {
+			Connection* c = g->cons + i;
+			start[flow_node(g, dir == FLOW_DOWN ? c->out : c->in) + 2]++;
+		}
+		for (i = 2; i < n + 2; i++)
+			start[i] += start[i - 1];
+		for (i = 0; i < g->con_count; i++) {
+			Connection* c = g->cons + i;
+			Port* from = dir == FLOW_DOWN ? c->out : c->in;
+			Port* to = dir == FLOW_DOWN ? c->in : c->out;
+			next[start[flow_node(g, from) + 1]++] = flow_node(g, to);
+		}
+		f->start[dir] = start;
+		f->next[dir] = next;
+	}
+}
+
+/* Tarjan's strongly connected components without recursion, linear in
+ * nodes and connections. Component of more than one node, or node
+ * connected to itself, is a feedback loop */
+static void find_loops(Graph* g) {
+	ClientFlow* f = &g->flow;
+	unsigned int n = f->node_count;
+	unsigned int* start = f->start[FLOW_DOWN];
+	unsigned int* next = f->next[FLOW_DOWN];
+	unsigned int i, e, s, index = 1, comps = 0;
+
+	f->scc = arena_alloc(&g->arena, (n + 1) * sizeof(unsigned int));
+	f->looped = arena_calloc(&g->arena, n + 1);
+	f->looped_count = 0;
+
+	unsigned int* idx = arena_calloc(&g->arena, (n + 1) * sizeof(unsigned int));
+	unsigned int* low = arena_alloc(&g->arena, (n + 1) * sizeof(unsigned int));
+	unsigned int* stack = arena_alloc(&g->arena, (n + 1) * sizeof(unsigned int));
+	unsigned int* calls = arena_alloc(&g->arena, (n + 1) * sizeof(unsigned int));
+	unsigned int* edge = arena_alloc(&g->arena, (n + 1) * sizeof(unsigned int));
+	bool* on_stack = arena_calloc(&g->arena, n + 1);
+	unsigned int sp = 0, cp = 0;
+
+	for (s = 0; s < n; s++) {
+		if (idx[s]) continue;
+
+		idx[s] = low[s] = index++;
+		stack[sp++] = s;
+		on_stack[s] = true;
+		calls[cp] = s;
+		edge[cp++] = start[s];
+
+		while (cp) {
+			unsigned int v = calls[cp - 1];
+			if (edge[cp - 1] < start[v + 1]) {
+				unsigned int w = next[edge[cp - 1]++];
+				if (! idx[w]) {
+					idx[w] = low[w] = index++;
+					stack[sp++] = w;
+					on_stack[w] = true;
+					calls[cp] = w;
+					edge[cp++] = start[w];
+				} else if (on_stack[w] && idx[w] < low[v]) {
+					low[v] = idx[w];
+				}
+				continue;
+			}
+
+			cp--;
+			if (low[v] == idx[v]) {
+				unsigned int w, size = 0;
+				do {
+					w = stack[--sp];
+					on_stack[w] = false;
+					f->scc[w] = comps;
+					size++;
+				} while (w != v);
+				if (size > 1) {
+					for (e = sp; e < sp + size; e++)
+						f->looped[stack[e]] = true;
+					f->looped_count += size;
+				}
+				comps++;
+			}
+			if (cp && low[v] < low[calls[cp - 1]])
+				low[calls[cp - 1]] = low[v];
+		}
+	}
+
+	for (i = 0; i < n; i++) {
+		for (e = start[i]; e < start[i + 1]; e++) {
+			if (next[e] == i && ! f->looped[i]) {
+				f->looped[i] = true;
+				f->looped_count++;
+			}
+		}
+	}
+}
+
+bool connection_looped(Graph* g, Connection* c) {
+	ClientFlow* f = &g->flow;
+	unsigned int a = flow_node(g, c->out), b = flow_node(g, c->in);
+	return f->looped[a] && f->scc[a] == f->scc[b];
+}
+
+/* New connection closes a loop when its output node is downstream of
+ * its input node. Only that edge is checked, with memoized closure */
+bool connect_makes_loop(Trace* t, Graph* g, Port* out, Port* in) {
+	return connect_batch_makes_loop(t, g, &out, &in, 1) == 0;
+}
+
+/* Marks are reader state, kept outside of shared generation */
+void mark_peers(Graph* g, Port* p, Bitset* marks, bool mark) {
+	Adjacency* adj = &g->adj;
+	if (! p || ! adj->peer) return;
+
+	unsigned int i = p - adj->base;
+	unsigned int j;
+	for (j = adj->start[i]; j < adj->start[i+1]; j++)
+		bitset_set(marks, adj->peer[j] - adj->base, mark);
+}
+
+/* TRACE */
+#define TRACE_BITS (8 * sizeof(unsigned long))
+#define TRACE_GET(b, n) ((b)[(n) / TRACE_BITS] & (1UL << ((n) % TRACE_BITS)))
+#define TRACE_SET(b, n) ((b)[(n) / TRACE_BITS] |= (1UL << ((n) % TRACE_BITS)))
+
+void trace_init(Trace* t) {
+	memset(t, 0, sizeof(Trace));
+	arena_init(&t->arena);
+}
+
+void trace_free(Trace* t) {
+	arena_free(&t->arena);
+}
+
+/* Ports grouped by flow node, counted into place */
+static void trace_prepare(Trace* t, Graph* g) {
+	unsigned int i, n = g->flow.node_count;
+	int dir;
+
+	if (t->generation == g->generation) return;
+	arena_reset(&t->arena);
+	t->generation = g->generation;
+	t->node_count = n;
+	t->words = n / TRACE_BITS + 1;
+
+	t->port_start = arena_calloc(&t->arena, (n + 2) * sizeof(unsigned int));
+	for (i = 0; i < g->count; i++)
+		t->port_start[flow_node(g, g->ports + i) + 2]++;
+	for (i = 2; i < n + 2; i++)
+		t->port_start[i] += t->port_start[i - 1];
+	t->port_list = arena_alloc(&t->arena, (g->count + 1) * sizeof(Port*));
+	for (i = 0; i < g->count; i++)
+		t->port_list[t->port_start[flow_node(g, g->ports + i) + 1]++] = g->ports + i;
+
+	for (dir = FLOW_DOWN; dir <= FLOW_UP; dir++)
+		t->closure[dir] = arena_calloc(&t->arena, (n + 1) * sizeof(unsigned long*));
+	t->queue = arena_alloc(&t->arena, (n + 1) * sizeof(unsigned int));
+	t->reach = arena_alloc(&t->arena, t->words * sizeof(unsigned long));
+}
+
+/* Nodes reachable from node c, c included. Closures known already
+ * are merged whole instead of being walked again */
+static unsigned long* trace_closure(Trace* t, Graph* g, unsigned int c, int dir) {
+	unsigned long** memo = t->closure[dir];
+	unsigned int* start = g->flow.start[dir];
+	unsigned int* next = g->flow.next[dir];
+	if (memo[c]) return memo[c];
+
+	unsigned long* bits = arena_calloc(&t->arena, t->words * sizeof(unsigned long));
+	unsigned int head = 0, tail = 0, i, w;
+
+	TRACE_SET(bits, c);
+	t->queue[tail++] = c;
+	while (head < tail) {
+		unsigned int x = t->queue[head++];
+		for (i = start[x]; i < start[x + 1]; i++) {
+			unsigned int y = next[i];
+			if (TRACE_GET(bits, y)) continue;
+			if (memo[y]) {
+				for (w = 0; w < t->words; w++) bits[w] |= memo[y][w];
+				continue;
+			}
+			TRACE_SET(bits, y);
+			t->queue[tail++] = y;
+		}
+	}
+	memo[c] = bits;
+	return bits;
+}
+
+bool trace_reaches(Trace* t, Graph* g, unsigned int from, unsigned int to) {
+	trace_prepare(t, g);
+	return TRACE_GET(trace_closure(t, g, from, FLOW_DOWN), to) != 0;
+}
+
+/* Batch of new connections out[i] -> in[i] closes a loop when output
+ * node of one is downstream of its input node, through graph or earlier
+ * connections of batch. Returns index of first such one, count if none */
+unsigned int connect_batch_makes_loop(Trace* t, Graph* g, Port** out, Port** in, unsigned int count) {
+	ClientFlow* f = &g->flow;
+	unsigned int i, j, w;
+
+	trace_prepare(t, g);
+	for (i = 0; i < count; i++) {
+		unsigned int a = flow_node(g, out[i]), b = flow_node(g, in[i]);
+		if (f->looped[a] && f->scc[a] == f->scc[b])
+			continue; /* loop is there already */
+		if (a == b) return i;
+
+		unsigned long* bits = trace_closure(t, g, b, FLOW_DOWN);
+		memcpy(t->reach, bits, t->words * sizeof(unsigned long));
+		bool grown = i > 0;
+		while (grown) {
+			grown = false;
+			for (j = 0; j < i; j++) {
+				unsigned int x = flow_node(g, out[j]), y = flow_node(g, in[j]);
+				if (! TRACE_GET(t->reach, x) || TRACE_GET(t->reach, y)) continue;
+				bits = trace_closure(t, g, y, FLOW_DOWN);
+				for (w = 0; w < t->words; w++) t->reach[w] |= bits[w];
+				grown = true;
+			}
+		}
+		if (TRACE_GET(t->reach, a)) return i;
+	}
+	return count;
+}
+
+/* Mark everything downstream of output or upstream of input: peers,
+ * then ports of reachable nodes facing on and their peers. Physical and
+ * terminal peers end the trace, their node has nothing facing on */
+void trace_mark(Trace* t, Graph* g, Port* p, Bitset* marks) {
+	Adjacency* adj = &g->adj;
+	if (! p || ! adj->peer) return;
+
+	trace_prepare(t, g);
+	int dir = (p->flags & JackPortIsOutput) ? FLOW_DOWN : FLOW_UP;
+	int facing = dir == FLOW_DOWN ? JackPortIsOutput : JackPortIsInput;
+	unsigned int i = p - adj->base;
+	unsigned int j, w, c;
+
+	memset(t->reach, 0, t->words * sizeof(unsigned long));
+	for (j = adj->start[i]; j < adj->start[i+1]; j++) {
+		Port* q = adj->peer[j];
+		bitset_set(marks, q - adj->base, true);
+		unsigned long* bits = trace_closure(t, g, flow_node(g, q), dir);
+		for (w = 0; w < t->words; w++) t->reach[w] |= bits[w];
+	}
+
+	for (c = 0; c < t->node_count; c++) {
+		if (! TRACE_GET(t->reach, c)) continue;
+		for (j = t->port_start[c]; j < t->port_start[c + 1]; j++) {
+			Port* q = t->port_list[j];
+			if (! (q->flags & facing)) continue;
+			bitset_set(marks, q - adj->base, true);
+			mark_peers(g, q, marks, true);
+		}
+	}
+}
+
+/* DIFF */
+static void diff_list_init(Arena* a, DiffList* l, unsigned int max) {
+	l->items = arena_alloc(a, (max + 1) * sizeof(void*));
+	l->count = 0;
+}
+
+static jack_port_id_t port_id(Port* p) {
+	return jack_uuid_to_index(p->uuid);
+}
+
+/* Connection key: ids of both ends */
+static unsigned long long con_key(Connection* c) {
+	return ((unsigned long long) port_id(c->out) << 32) | port_id(c->in);
+}
+
+static unsigned int con_hash(unsigned long long k) {
+	k *= 0x9E3779B97F4A7C15ull;
+	return k >> 32;
+}
+
+void graph_diff_init(GraphDiff* d) {
+	memset(d, 0, sizeof(GraphDiff));
+	arena_init(&d->arena);
+}
+
+/* Ports are matched by id, which survives generations, so everything
+ * is one pass over both graphs with O(1) lookups. Storage of previous
+ * diff is reused */
+void graph_diff(Graph* old, Graph* new, GraphDiff* d) {
+	unsigned int i;
+
+	arena_reset(&d->arena);
+	diff_list_init(&d->arena, &d->ports_added, new->count);
+	diff_list_init(&d->arena, &d->ports_removed, old->count);
+	diff_list_init(&d->arena, &d->ports_renamed, new->count);
+	diff_list_init(&d->arena, &d->cons_added, new->con_count);
+	diff_list_init(&d->arena, &d->cons_removed, old->con_count);
+	d->latency_changed = 0;
+
+	/* PORTS */
+	unsigned char* seen = arena_calloc(&d->arena, old->count + 1);
+	for (i = 0; i < new->count; i++) {
+		Port* p = new->ports + i;
+		Port* o = jack_uuid_empty(p->uuid) ? NULL : get_port_by_id(old, port_id(p));
+
+		if (! o || o->uuid != p->uuid || o->type != p->type || o->flags != p->flags) {
+			d->ports_added.items[d->ports_added.count++] = p;
+			continue;
+		}
+		seen[o - old->ports] = true;
+		if (o->latency != p->latency || o->path != p->path)
+			d->latency_changed++;
+
+		Client* oc = old->clients + o->client;
+		Client* pc = new->clients + p->client;
+		if (o->name_len != p->name_len || oc->name_len != pc->name_len ||
+		    strcmp(old->names + o->name, new->names + p->name) ||
+		    strcmp(old->names + oc->name, new->names + pc->name))
+			d->ports_renamed.items[d->ports_renamed.count++] = p;
+	}
+	for (i = 0; i < old->count; i++) {
+		if (! seen[i])
+			d->ports_removed.items[d->ports_removed.count++] = old->ports + i;
+	}
+
+	/* CONNECTIONS: hash set of old keys */
+	HashIndex idx;
+	hash_index_init(&idx, old->con_count, &d->arena);
+	for (i = 0; i < old->con_count; i++) {
+		unsigned int h = con_hash(con_key(old->cons + i)) & idx.mask;
+		while (idx.slot[h]) h = (h + 1) & idx.mask;
+		idx.slot[h] = i + 1;
+	}
+
+	seen = arena_calloc(&d->arena, old->con_count + 1);
+	for (i = 0; i < new->con_count; i++) {
+		Connection* c = new->cons + i;
+		unsigned long long k = con_key(c);
+		unsigned int h = con_hash(k) & idx.mask;
+		bool found = false;
+
+		for (; idx.slot[h]; h = (h + 1) & idx.mask) {
+			if (con_key(old->cons + idx.slot[h] - 1) == k) {
+				seen[idx.slot[h] - 1] = true;
+				found = true;
+				break;
+			}
+		}
+		if (! found)
+			d->cons_added.items[d->cons_added.count++] = c;
+	}
+	for (i = 0; i < old->con_count; i++) {
+		if (! seen[i])
+			d->cons_removed.items[d->cons_removed.count++] = old->cons + i;
+	}
+}
+
+bool graph_diff_empty(GraphDiff* d) {
+	return ! ( d->ports_added.count || d->ports_removed.count ||
+		d->ports_renamed.count || d->cons_added.count || d->cons_removed.count ||
+		d->latency_changed );
+}
+
+void free_graph_diff(GraphDiff* d) {
+	arena_free(&d->arena);
+}
+
+/* Sum of name hashes of ports and connections: same for generations
+ * showing same graph whatever its order */
+unsigned int graph_hash(Graph* g) {
+	unsigned int i, ret = 0;
+
+	for (i = 0; i < g->count; i++)
+		ret += hash_port(g, g->ports + i);
+	for (i = 0; i < g->con_count; i++) {
+		Connection* c = g->cons + i;
+		ret += hash_port(g, c->out) * 16777619u ^ hash_port(g, c->in);
+	}
+	return ret;
+}
+
+/* GENERATIONS */
+/* Last released generation is kept, next one reuses its storage */
+static _Atomic(Graph*) spare_graph = NULL;
+
+/* Empty generation, heap is touched only when there is no spare */
+static Graph* graph_alloc(unsigned long generation) {
+	Graph* g = atomic_exchange(&spare_graph, NULL);
+	unsigned int heap_allocs = 0;
+	Arena arena;
+
+	if (g) {
+		arena = g->arena;
+		arena_reset(&arena);
+	} else {
+		g = malloc(sizeof(Graph));
+		arena_init(&arena);
+		heap_allocs = 1;
+	}
+
+	memset(g, 0, sizeof(Graph));
+	g->arena = arena;
+	g->heap_allocs = heap_allocs;
+	atomic_init(&g->refs, 1);
+	g->generation = generation;
+	return g;
+}
+
+/* All tables of generation live in its arena, temporaries in scratch
+ * which caller keeps between builds */
+Graph* graph_build(jack_client_t* client, unsigned long generation, Arena* scratch) {
+	Graph* g = graph_alloc(generation);
+
+	unsigned long long t;
+
+	arena_reset(scratch);
+	t = perf_start();
+	build_ports(client, g, scratch);
+	perf_stop(PERF_BUILD_PORTS, t);
+	t = perf_start();
+	build_connections(client, g, scratch);
+	perf_stop(PERF_BUILD_CONNECTIONS, t);
+	graph_finish(g);
+	g->heap_allocs += scratch->heap_allocs;
+	return g;
+}
+
+/* Only clients with ports and names in use are copied, so generations
+ * do not grow while ports come and go between builds */
+static void clone_names(Graph* n, Graph* g) {
+	unsigned int* map = arena_calloc(&n->arena, (g->client_count + 1) * sizeof(unsigned int));
+	unsigned int i;
+
+	for (i = 0; i < n->count; i++)
+		map[n->ports[i].client] = 1;
+
+	/* Kept clients stay in order, map holds new index + 1 */
+	n->client_count = 0;
+	n->names_size = 0;
+	for (i = 0; i < g->client_count; i++) {
+		if (! map[i]) continue;
+		Client* c = n->clients + n->client_count;
+		c->name_len = g->clients[i].name_len;
+		c->name = names_add(n, g->names + g->clients[i].name, c->name_len);
+		map[i] = ++n->client_count;
+	}
+
+	for (i = 0; i < n->count; i++) {
+		Port* p = n->ports + i;
+		p->client = map[p->client] - 1;
+		p->name = names_add(n, g->names + p->name, p->name_len);
+	}
+}
+
+/* Private copy for next generation, published after graph_finish */
+Graph* graph_clone(Graph* g, unsigned long generation) {
+	Graph* n = graph_alloc(generation);
+	Arena arena = n->arena;
+	unsigned int heap_allocs = n->heap_allocs;
+
+	memcpy(n, g, sizeof(Graph));
+	atomic_init(&n->refs, 1);
+	n->generation = generation;
+	n->arena = arena;
+	n->heap_allocs = heap_allocs;
+	memset(&n->adj, 0, sizeof(Adjacency));
+	memset(&n->flow, 0, sizeof(ClientFlow));
+	Arena* a = &n->arena;
+
+	n->ports = arena_alloc(a, (g->count + 1) * sizeof(Port));
+	memcpy(n->ports, g->ports, g->count * sizeof(Port));
+	n->ranges = arena_alloc(a, (2 * g->type_count + 1) * sizeof(Range));
+	memcpy(n->ranges, g->ranges, (2 * g->type_count + 1) * sizeof(Range));
+	n->type_tags = arena_alloc(a, g->type_count + 1);
+	memcpy(n->type_tags, g->type_tags, g->type_count);
+	n->cons = arena_alloc(a, (g->con_count + 1) * sizeof(Connection));
+	memcpy(n->cons, g->cons, g->con_count * sizeof(Connection));
+	rebase_connections(n, g->ports, 0, 0);
+	n->con_ranges = arena_alloc(a, (g->type_count + 1) * sizeof(Range));
+	memcpy(n->con_ranges, g->con_ranges, (g->type_count + 1) * sizeof(Range));
+
+	/* Room as intern_client expects it */
+	n->clients = arena_alloc(a, 2 * (g->client_count + 1) * sizeof(Client));
+	n->names = arena_alloc(a, g->names_size + 1);
+	clone_names(n, g);
+	n->by_id = arena_alloc(a, (g->id_count + 1) * sizeof(unsigned int));
+	memcpy(n->by_id, g->by_id, (g->id_count + 1) * sizeof(unsigned int));
+	return n;
+}
+
+/* Derived data, last step before generation is published */
+void graph_finish(Graph* g) {
+	build_adjacency(&g->adj, g);
+	update_paths(g);
+	build_flow_edges(g);
+	find_loops(g);
+	g->allocs = g->arena.allocs;
+	g->heap_allocs += g->arena.heap_allocs;
+}
+
+Graph* graph_ref(Graph* g) {
+	atomic_fetch_add(&g->refs, 1);
+	return g;
+}
+
+static void graph_free(Graph* g) {
+	if (! g) return;
+	arena_free(&g->arena);
+	free(g);
+}
+
+void graph_unref(Graph* g) {
+	if (! g || atomic_fetch_sub(&g->refs, 1) != 1) return;
+
+	/* Older spare goes, newer one is closer in size to what comes next */
+	graph_free( atomic_exchange(&spare_graph, g) );
+}
+
+void graph_free_spare(void) {
+	graph_free( atomic_exchange(&spare_graph, NULL) );
+}
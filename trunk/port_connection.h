@@ -2,28 +2,173 @@
 #define PORT_CONNECTION_H
 
 #include <stdbool.h>
+#include <stdatomic.h>
 #include <jack/jack.h>
-#include <jack/jslist.h>
+
+#include "arena.h"
+#include "bitset.h"
+
+/* Pseudo type id of view showing every type */
+#define PORT_TYPE_ALL ((unsigned short) -1)
 
 typedef struct {
-	char name[128];
-	char type[32];
-	int flags;
-	bool mark;
+	jack_port_t* jport;     /* cached handle, valid until port unregisters */
+	jack_uuid_t uuid;
+	unsigned int name;      /* offset of short name in names arena */
+	unsigned int client;    /* index in clients table */
+	unsigned short name_len;
+	unsigned short type;    /* port type id */
+	unsigned char flags;    /* JackPortFlags */
+	bool path_stale;        /* connections changed since path was computed */
+	jack_nframes_t latency; /* max capture latency of output, playback of input */
+	jack_nframes_t path;    /* worst capture to playback latency through port */
 } Port;
 
 typedef struct {
-	const char* type;
+	unsigned int name;      /* offset in names arena */
+	unsigned short name_len;
+} Client;
+
+typedef struct {
+	unsigned short type;
 	Port* in;
 	Port* out;
 } Connection;
 
-JSList* build_connections(jack_client_t* client, JSList* list, const char* type);
-void free_connections( JSList* list_con );
-JSList* build_ports(jack_client_t* client);
-void free_all_ports(JSList* all_ports);
-JSList* select_ports(JSList* list, int flags, const char* type);
-Port* get_port_by_name(JSList* list, const char* name);
-int get_max_port_name ( JSList* list );
+/* Slice of ports or connections table */
+typedef struct {
+	unsigned int start;
+	unsigned int count;
+} Range;
+
+/* Compressed sparse row adjacency over all ports block:
+ * peers of port i are peer[start[i]] .. peer[start[i+1]-1] */
+typedef struct {
+	Port* base;
+	unsigned int count;
+	unsigned int* start;
+	Port** peer;
+} Adjacency;
+
+enum FlowDir { FLOW_DOWN, FLOW_UP };
+
+/* Client level graph: each connection is an edge between clients of its
+ * ends. Physical and terminal ports are where signal enters or leaves,
+ * it does not pass through their client: their outputs are a source
+ * node and their inputs a sink node, after the clients.
+ * Strongly connected components of it are feedback loops */
+typedef struct {
+	unsigned int node_count; /* clients, then sources, then sinks */
+	unsigned int* start[2]; /* edges of node c: next[start[c]] .. next[start[c+1]-1] */
+	unsigned int* next[2];
+	unsigned int* scc;      /* component of each node */
+	bool* looped;           /* node is on a feedback loop */
+	unsigned int looped_count;
+} ClientFlow;
+
+/* All ports of the server, client and port names interned in one arena.
+ * Ports are partitioned by direction and type, connections by type,
+ * so per type views are ranges of these tables.
+ * Published generations are immutable, readers hold a reference */
+typedef struct {
+	atomic_uint refs;
+	unsigned long generation;
+	Port* ports;
+	unsigned int count;
+	unsigned short type_count;
+	char* type_tags;   /* marker per type */
+	Range* ranges;     /* outputs of each type, then inputs */
+	Connection* cons;
+	unsigned int con_count;
+	Range* con_ranges; /* per type */
+	Client* clients;
+	unsigned int client_count;
+	char* names;
+	size_t names_size;
+	unsigned int* by_id;     /* port id -> index + 1 */
+	unsigned int id_count;
+	unsigned int jack_calls; /* server queries of last update */
+	unsigned int allocs;      /* arena allocations of generation */
+	unsigned int heap_allocs; /* heap allocations behind them */
+	bool paths_stale;         /* latencies reread, every path is stale */
+	Adjacency adj;
+	ClientFlow flow;
+	Arena arena; /* owns all tables above */
+} Graph;
+
+/* Changes between two generations, items point into the generation
+ * they exist in: removed into old one, added and renamed into new one */
+typedef struct {
+	void** items;
+	unsigned int count;
+} DiffList;
+
+typedef struct {
+	DiffList ports_added;
+	DiffList ports_removed;
+	DiffList ports_renamed;
+	DiffList cons_added;
+	DiffList cons_removed;
+	unsigned int latency_changed; /* ports in both with other latency */
+	Arena arena;
+} GraphDiff;
+
+/* Signal flow between clients, every input of client is taken to feed
+ * each of its outputs, except physical and terminal ones which end the
+ * flow. Reader state for one generation: node closures are computed on
+ * first use and kept until generation changes */
+typedef struct {
+	unsigned long generation; /* tables below belong to, 0 for none */
+	unsigned int node_count;
+	unsigned int words;       /* per node bit set */
+	unsigned int* port_start; /* ports of node c: port_list[port_start[c]] .. */
+	Port** port_list;
+	unsigned long** closure[2];  /* per node, NULL until needed */
+	unsigned int* queue;
+	unsigned long* reach;
+	Arena arena;
+} Trace;
+
+Graph* graph_build(jack_client_t* client, unsigned long generation, Arena* scratch);
+Graph* graph_clone(Graph* g, unsigned long generation);
+void graph_finish(Graph* g);
+Graph* graph_ref(Graph* g);
+void graph_unref(Graph* g);
+void graph_free_spare(void);
+void graph_diff_init(GraphDiff* d);
+void graph_diff(Graph* old, Graph* new, GraphDiff* d);
+bool graph_diff_empty(GraphDiff* d);
+void free_graph_diff(GraphDiff* d);
+
+void build_connections(jack_client_t* client, Graph* g, Arena* scratch);
+Range select_connections(Graph* g, unsigned short type);
+void build_ports(jack_client_t* client, Graph* g, Arena* scratch);
+Range select_ports(Graph* g, int flags, unsigned short type);
+Port* get_port_by_id(Graph* g, jack_port_id_t id);
+bool graph_add_ports(jack_client_t* client, Graph* g, jack_port_id_t* ids, unsigned int count);
+bool graph_remove_ports(Graph* g, jack_port_id_t* ids, unsigned int count);
+unsigned int graph_hash(Graph* g);
+bool graph_connect(Graph* g, Port* a, Port* b);
+bool graph_disconnect(Graph* g, Port* a, Port* b);
+void graph_read_latency(Graph* g);
+int get_max_port_name ( Graph* g, Port* ports, unsigned int count );
+const char* port_name(Graph* g, Port* p);
+const char* port_client_name(Graph* g, Port* p);
+unsigned int port_name_len(Graph* g, Port* p);
+int port_connect(jack_client_t* client, Graph* g, Port* out, Port* in);
+int port_disconnect(jack_client_t* client, Graph* g, Port* out, Port* in);
+unsigned short port_type_id(const char* type);
+unsigned short port_type_count(void);
+const char* port_type_name(unsigned short id);
+char port_type_tag(Graph* g, unsigned short id);
+void build_adjacency(Adjacency* adj, Graph* g);
+void mark_peers(Graph* g, Port* p, Bitset* marks, bool mark);
+void trace_init(Trace* t);
+void trace_mark(Trace* t, Graph* g, Port* p, Bitset* marks);
+bool trace_reaches(Trace* t, Graph* g, unsigned int from, unsigned int to);
+bool connection_looped(Graph* g, Connection* c);
+bool connect_makes_loop(Trace* t, Graph* g, Port* out, Port* in);
+unsigned int connect_batch_makes_loop(Trace* t, Graph* g, Port** out, Port** in, unsigned int count);
+void trace_free(Trace* t);
 
 #endif /* PORT_CONNECTION_H */
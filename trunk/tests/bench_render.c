@@ -0,0 +1,203 @@
+#include <poll.h>
+#include <pty.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+/* Render benchmark: runs program on a pty, feeds it keys from script and
+ * measures output of each step: bytes, write syscalls and wall time
+ * until screen settles, and memory after it. Steps over their limits,
+ * crash or failed quit fail the run.
+ *
+ * Script lines: name keys max_bytes max_writes max_ms
+ * keys "-" sends nothing, "@N" reads for N seconds,
+ * \t \s \n \e escapes are known, limit "-" is none */
+
+#define ROWS 40
+#define COLS 120
+#define QUIET_MS 150    /* no output this long: frame is done */
+#define STEP_MS 5000    /* give up on step */
+
+typedef struct {
+	char name[32];
+	char label[32]; /* keys as written in script */
+	char keys[32];
+	double hold_ms; /* read at least this long */
+	long max[3]; /* bytes, writes, ms; -1 for none */
+} Step;
+
+static double now_ms(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+/* Field of /proc/<pid>/FILE, -1 when not there */
+static long proc_field(pid_t pid, const char* file, const char* field) {
+	char path[64], line[128];
+	size_t len = strlen(field);
+	long ret = -1;
+
+	snprintf(path, sizeof(path), "/proc/%d/%s", (int) pid, file);
+	FILE* f = fopen(path, "r");
+	if (! f) return -1;
+	while (fgets(line, sizeof(line), f)) {
+		if (strncmp(line, field, len) == 0 && line[len] == ':') {
+			ret = atol(line + len + 1);
+			break;
+		}
+	}
+	fclose(f);
+	return ret;
+}
+
+/* Write syscalls of whole process so far */
+static long proc_syscw(pid_t pid) {
+	return proc_field(pid, "io", "syscw");
+}
+
+static void unescape(char* s) {
+	char* d = s;
+	for (; *s; s++) {
+		if (*s != '\\' || ! s[1]) { *d++ = *s; continue; }
+		switch (*++s) {
+			case 't': *d++ = '\t'; break;
+			case 's': *d++ = ' '; break;
+			case 'n': *d++ = '\n'; break;
+			case 'e': *d++ = '\033'; break;
+			default: *d++ = *s;
+		}
+	}
+	*d = '\0';
+}
+
+static long limit(const char* s) {
+	return strcmp(s, "-") == 0 ? -1 : atol(s);
+}
+
+static unsigned int load_script(const char* path, Step* steps, unsigned int max) {
+	char line[256], b[32], w[32], t[32];
+	unsigned int n = 0;
+
+	FILE* f = fopen(path, "r");
+	if (! f) {
+		perror(path);
+		exit(2);
+	}
+	while (n < max && fgets(line, sizeof(line), f)) {
+		Step* s = steps + n;
+		if (line[0] == '#' || sscanf(line, "%31s %31s %31s %31s %31s", s->name, s->keys, b, w, t) != 5)
+			continue;
+		strcpy(s->label, s->keys);
+		s->hold_ms = s->keys[0] == '@' ? atof(s->keys + 1) * 1e3 : 0;
+		if (strcmp(s->keys, "-") == 0 || s->hold_ms) s->keys[0] = '\0';
+		unescape(s->keys);
+		s->max[0] = limit(b);
+		s->max[1] = limit(w);
+		s->max[2] = limit(t);
+		n++;
+	}
+	fclose(f);
+	return n;
+}
+
+/* Read until output stops, hold steps for hold time only.
+ * Returns bytes, time to last byte in ms */
+static long drain(int fd, double start, double hold, double* last) {
+	char buf[65536];
+	long bytes = 0;
+	struct pollfd p = { fd, POLLIN, 0 };
+	int ready;
+
+	*last = start;
+	while (now_ms() - start < hold + STEP_MS && (ready = poll(&p, 1, QUIET_MS)) >= 0) {
+		if (! ready) {
+			if (now_ms() - start >= hold) break;
+			continue;
+		}
+		ssize_t r = read(fd, buf, sizeof(buf));
+		if (r <= 0) break; /* program is gone */
+		bytes += r;
+		*last = now_ms();
+		if (hold && *last - start >= hold) break; /* output goes on, next step has it */
+	}
+	return bytes;
+}
+
+int main(int argc, char* argv[]) {
+	struct winsize ws = { ROWS, COLS, 0, 0 };
+	Step steps[64];
+	unsigned int i, n, over = 0;
+	int fd, status;
+
+	if (argc < 3) {
+		fprintf(stderr, "usage: %s SCRIPT PROGRAM [ARGS]\n", argv[0]);
+		return 2;
+	}
+	n = load_script(argv[1], steps, 64);
+
+	pid_t pid = forkpty(&fd, NULL, NULL, &ws);
+	if (pid < 0) {
+		perror("forkpty");
+		return 2;
+	}
+	if (pid == 0) {
+		setenv("TERM", "xterm", 0);
+		execvp(argv[2], argv + 2);
+		perror(argv[2]);
+		_exit(127);
+	}
+
+	printf("%-12s %-6s %8s %7s %8s %8s\n", "step", "keys", "bytes", "writes", "ms", "rss_kb");
+	for (i = 0; i < n; i++) {
+		Step* s = steps + i;
+		long writes = proc_syscw(pid);
+		double start = now_ms(), last;
+
+		if (*s->keys && write(fd, s->keys, strlen(s->keys)) < 0) break;
+		long bytes = drain(fd, start, s->hold_ms, &last);
+		long got[3] = { bytes, proc_syscw(pid) - writes, (long) (last - start) };
+
+		bool fail = false;
+		for (unsigned int k = 0; k < 3; k++)
+			if (s->max[k] >= 0 && got[k] > s->max[k]) fail = true;
+		over += fail;
+		printf("%-12s %-6.6s %8ld %7ld %8.1f %8ld%s\n", s->name, s->label,
+			got[0], got[1], last - start, proc_field(pid, "status", "VmRSS"),
+			fail ? "  over limit" : "");
+		fflush(stdout);
+	}
+
+	/* Quit and see that it went cleanly */
+	if (write(fd, "q", 1) < 0) { /* gone already, status tells */ }
+	double start = now_ms(), last;
+	pid_t done = 0;
+	drain(fd, start, 0, &last);
+	while (! done && now_ms() - start < STEP_MS) {
+		done = waitpid(pid, &status, WNOHANG);
+		if (! done) usleep(10000);
+	}
+	if (! done) {
+		kill(pid, SIGTERM);
+		waitpid(pid, &status, 0);
+		fprintf(stderr, "bench: program did not quit\n");
+		return 1;
+	}
+	if (! WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+		fprintf(stderr, "bench: program %s %d\n", WIFSIGNALED(status) ? "died of signal" : "exited with",
+			WIFSIGNALED(status) ? WTERMSIG(status) : WEXITSTATUS(status));
+		return 1;
+	}
+	if (over) {
+		fprintf(stderr, "bench: %u steps over limit\n", over);
+		return 1;
+	}
+	printf("bench: all steps within limits\n");
+	return 0;
+}
@@ -0,0 +1,562 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <jack/uuid.h>
+
+#include "../port_connection.h"
+#include "../window.h"
+#include "mockjack.h"
+
+/* Model checks against mock server, no Jack or terminal needed */
+
+static unsigned int failures;
+
+#define CHECK(cond) do { \
+	if (! (cond)) { \
+		fprintf(stderr, "%s:%d: %s: check failed: %s\n", __FILE__, __LINE__, __func__, #cond); \
+		failures++; \
+		return; \
+	} \
+} while (0)
+
+/* Every heap allocation in the process is counted, also those behind
+ * arenas and inside libc */
+extern void* __libc_malloc(size_t size);
+extern void* __libc_calloc(size_t n, size_t size);
+extern void* __libc_realloc(void* p, size_t size);
+static unsigned long heap_calls;
+
+void* malloc(size_t size) {
+	heap_calls++;
+	return __libc_malloc(size);
+}
+
+void* calloc(size_t n, size_t size) {
+	heap_calls++;
+	return __libc_calloc(n, size);
+}
+
+void* realloc(void* p, size_t size) {
+	heap_calls++;
+	return __libc_realloc(p, size);
+}
+
+static double now_ms(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+/* Scratch of builds, kept between checks as UI keeps it */
+static Arena scratch;
+
+/* Every check starts from empty server and no spare generation, also
+ * after one before it stopped at failed CHECK. Generations a failed
+ * check held are left behind */
+static void fixture_begin(void) {
+	mock_reset();
+	graph_free_spare();
+}
+
+static Graph* build(void) {
+	static unsigned long generation;
+	return graph_build(NULL, ++generation, &scratch);
+}
+
+/* 200k ports with long names, past every 16 bit limit and the old
+ * 128 byte name buffer */
+#define SCALE_CLIENTS 200
+#define SCALE_PORTS 500 /* of each direction per client */
+static void check_scale(void) {
+	jack_port_t** outs = malloc(SCALE_CLIENTS * SCALE_PORTS * sizeof(jack_port_t*));
+	jack_port_t** ins = malloc(SCALE_CLIENTS * SCALE_PORTS * sizeof(jack_port_t*));
+	char name[320], prefix[200];
+	unsigned int c, i;
+
+	fixture_begin();
+	memset(prefix, 'x', sizeof(prefix) - 1);
+	prefix[sizeof(prefix) - 1] = '\0';
+	for (c = 0; c < SCALE_CLIENTS; c++) {
+		for (i = 0; i < SCALE_PORTS; i++) {
+			snprintf(name, sizeof(name), "pw_client_%u:%s_out_%u", c, prefix, i);
+			outs[c * SCALE_PORTS + i] = mock_port(name, JACK_DEFAULT_AUDIO_TYPE, JackPortIsOutput);
+			snprintf(name, sizeof(name), "pw_client_%u:%s_in_%u", c, prefix, i);
+			ins[c * SCALE_PORTS + i] = mock_port(name, JACK_DEFAULT_AUDIO_TYPE, JackPortIsInput);
+		}
+	}
+	for (c = 0; c + 1 < SCALE_CLIENTS; c++)
+		for (i = 0; i < SCALE_PORTS; i++)
+			mock_connect(outs[c * SCALE_PORTS + i], ins[(c + 1) * SCALE_PORTS + i]);
+	jack_port_t* last = ins[SCALE_CLIENTS * SCALE_PORTS - 1];
+	free(outs);
+	free(ins);
+
+	double t = now_ms();
+	Graph* g = build();
+	t = now_ms() - t;
+
+	unsigned int ports = 2 * SCALE_CLIENTS * SCALE_PORTS;
+	unsigned int cons = (SCALE_CLIENTS - 1) * SCALE_PORTS;
+	unsigned short audio = port_type_id(JACK_DEFAULT_AUDIO_TYPE);
+	printf("  scale: %u ports, %u connections built in %.0f ms\n", g->count, g->con_count, t);
+
+	CHECK(g->count == ports);
+	CHECK(g->con_count == cons);
+	CHECK(g->client_count == SCALE_CLIENTS);
+	CHECK(select_ports(g, JackPortIsOutput, audio).count == ports / 2);
+	CHECK(select_ports(g, JackPortIsInput, audio).count == ports / 2);
+	CHECK(select_connections(g, audio).count == cons);
+
+	/* Names come back whole and ids lead to the right ports */
+	snprintf(name, sizeof(name), "pw_client_%u:%s_in_%u", SCALE_CLIENTS - 1, prefix, SCALE_PORTS - 1);
+	Port* p = get_port_by_id(g, jack_uuid_to_index(jack_port_uuid(last)));
+	CHECK(p && p->jport == last);
+	CHECK(port_name_len(g, p) == strlen(name));
+	CHECK(strcmp(port_name(g, p), strchr(name, ':') + 1) == 0);
+
+	graph_unref(g);
+}
+
+static jack_port_id_t port_id(jack_port_t* p) {
+	return jack_uuid_to_index(jack_port_uuid(p));
+}
+
+/* Client registering many ports against a big graph: ports table is
+ * copied once per run of events, result matches a full build */
+#define ADD_BASE 20000
+#define ADD_NEW 1000
+static void check_add_ports(void) {
+	jack_port_id_t ids[ADD_NEW + 2];
+	jack_port_t *out = NULL, *in = NULL;
+	char name[64];
+	unsigned int i;
+	GraphDiff d;
+
+	fixture_begin();
+	for (i = 0; i < ADD_BASE / 2; i++) {
+		snprintf(name, sizeof(name), "base_%u:out", i);
+		out = mock_port(name, JACK_DEFAULT_AUDIO_TYPE, JackPortIsOutput);
+		snprintf(name, sizeof(name), "base_%u:in", i);
+		in = mock_port(name, JACK_DEFAULT_AUDIO_TYPE, JackPortIsInput);
+		mock_connect(out, in);
+	}
+	jack_port_t* base_in = mock_port("base:in", JACK_DEFAULT_AUDIO_TYPE, JackPortIsInput);
+	mock_connect(out, base_in);
+
+	Graph* g = build();
+	Graph* n = graph_clone(g, g->generation + 1000);
+
+	for (i = 0; i < ADD_NEW; i++) {
+		snprintf(name, sizeof(name), "synth:%s_%u", i % 2 ? "in" : "out", i);
+		jack_port_t* p = mock_port(name, i % 3 ? JACK_DEFAULT_AUDIO_TYPE : JACK_DEFAULT_MIDI_TYPE,
+			i % 2 ? JackPortIsInput : JackPortIsOutput);
+		ids[ADD_NEW - 1 - i] = port_id(p);
+	}
+	ids[ADD_NEW] = ids[1]; /* duplicate event */
+	ids[ADD_NEW + 1] = port_id(base_in); /* known port */
+
+	unsigned int allocs = n->arena.allocs;
+	bool added = graph_add_ports(NULL, n, ids, ADD_NEW + 2);
+	allocs = n->arena.allocs - allocs;
+	graph_finish(n);
+	printf("  add ports: %u ports added to %u in %u arena allocations\n",
+		n->count - g->count, g->count, allocs);
+	CHECK(added);
+	CHECK(n->count == g->count + ADD_NEW);
+	CHECK(n->con_count == g->con_count);
+	CHECK(allocs < 20);
+
+	Graph* full = build();
+	graph_diff_init(&d);
+	graph_diff(n, full, &d);
+	CHECK(graph_diff_empty(&d));
+	for (i = 0; i < n->con_count; i++) {
+		CHECK(n->cons[i].out->flags & JackPortIsOutput);
+		CHECK(n->cons[i].in->flags & JackPortIsInput);
+	}
+
+	free_graph_diff(&d);
+	graph_unref(full);
+	graph_unref(n);
+	graph_unref(g);
+}
+
+/* Client with many connected ports leaving a big graph: ports and
+ * connections are compacted once per run of events, id index is kept */
+#define REMOVE_BASE 20000
+#define REMOVE_GONE 1000
+static void check_remove_ports(void) {
+	jack_port_id_t ids[REMOVE_GONE + 2];
+	jack_port_t* gone[REMOVE_GONE];
+	jack_port_t* in = NULL;
+	char name[64];
+	unsigned int i;
+	GraphDiff d;
+
+	fixture_begin();
+	for (i = 0; i < REMOVE_BASE / 2; i++) {
+		snprintf(name, sizeof(name), "base_%u:out", i);
+		jack_port_t* out = mock_port(name, JACK_DEFAULT_AUDIO_TYPE, JackPortIsOutput);
+		snprintf(name, sizeof(name), "base_%u:in", i);
+		in = mock_port(name, JACK_DEFAULT_AUDIO_TYPE, JackPortIsInput);
+		mock_connect(out, in);
+	}
+	for (i = 0; i < REMOVE_GONE; i++) {
+		snprintf(name, sizeof(name), "synth:%s_%u", i % 2 ? "in" : "out", i);
+		gone[i] = mock_port(name, i % 3 ? JACK_DEFAULT_AUDIO_TYPE : JACK_DEFAULT_MIDI_TYPE,
+			i % 2 ? JackPortIsInput : JackPortIsOutput);
+		if (i % 6 == 2) mock_connect(gone[i], in);
+		ids[i] = port_id(gone[i]);
+	}
+	ids[REMOVE_GONE] = ids[1]; /* repeated event */
+	ids[REMOVE_GONE + 1] = ids[0] + REMOVE_BASE; /* unknown port */
+
+	Graph* g = build();
+	Graph* n = graph_clone(g, g->generation + 1000);
+	for (i = 0; i < REMOVE_GONE; i++)
+		mock_unregister(gone[i]);
+
+	unsigned int allocs = n->arena.allocs;
+	double t = now_ms();
+	bool removed = graph_remove_ports(n, ids, REMOVE_GONE + 2);
+	t = now_ms() - t;
+	allocs = n->arena.allocs - allocs;
+	graph_finish(n);
+	printf("  remove ports: %u ports removed from %u in %u arena allocations, %.1f ms\n",
+		g->count - n->count, g->count, allocs, t);
+	CHECK(removed);
+	CHECK(n->count == REMOVE_BASE);
+	CHECK(n->con_count == REMOVE_BASE / 2);
+	CHECK(allocs == 1);
+	CHECK(get_port_by_id(n, ids[0]) == NULL);
+	CHECK(get_port_by_id(n, port_id(in)) && get_port_by_id(n, port_id(in))->jport == in);
+	CHECK(! graph_remove_ports(n, ids, REMOVE_GONE));
+
+	Graph* full = build();
+	graph_diff_init(&d);
+	graph_diff(n, full, &d);
+	CHECK(graph_diff_empty(&d));
+	for (i = 0; i < n->con_count; i++) {
+		CHECK(n->cons[i].out->flags & JackPortIsOutput);
+		CHECK(n->cons[i].in->flags & JackPortIsInput);
+	}
+
+	free_graph_diff(&d);
+	graph_unref(full);
+	graph_unref(n);
+	graph_unref(g);
+}
+
+/* Ports of short lived clients come and go between builds: clones keep
+ * only names and clients still in use */
+#define CHURN_ROUNDS 1000
+
+static void check_churn_clones(void) {
+	char name[64];
+	unsigned int i;
+
+	fixture_begin();
+	mock_port("system:capture_1", JACK_DEFAULT_AUDIO_TYPE, JackPortIsOutput | JackPortIsPhysical);
+	mock_port("system:playback_1", JACK_DEFAULT_AUDIO_TYPE, JackPortIsInput | JackPortIsPhysical);
+
+	Graph* g = build();
+	unsigned int clients = g->client_count;
+	size_t names = g->names_size;
+
+	for (i = 0; i < CHURN_ROUNDS; i++) {
+		snprintf(name, sizeof(name), "churn_%u:out", i);
+		jack_port_t* p = mock_port(name, JACK_DEFAULT_AUDIO_TYPE, JackPortIsOutput);
+		jack_port_id_t id = port_id(p);
+
+		Graph* n = graph_clone(g, g->generation + 1);
+		graph_add_ports(NULL, n, &id, 1);
+		graph_finish(n);
+		graph_unref(g);
+
+		mock_unregister(p);
+		g = graph_clone(n, n->generation + 1);
+		graph_remove_ports(g, &id, 1);
+		graph_finish(g);
+		graph_unref(n);
+	}
+
+	/* Names of port removed last go with next clone */
+	Graph* n = graph_clone(g, g->generation + 1);
+	graph_finish(n);
+	graph_unref(g);
+	g = n;
+	printf("  churn clones: %u clients, %zu name bytes after %u ports came and went\n",
+		g->client_count, g->names_size, CHURN_ROUNDS);
+	CHECK(g->count == 2);
+	CHECK(g->client_count == clients);
+	CHECK(g->names_size == names);
+
+	graph_unref(g);
+}
+
+/* Steady refresh reuses spare generation, scratch and diff storage:
+ * only blocks server hands out may come from heap */
+#define REFRESH_PORTS 100
+#define REFRESH_WARMUP 10
+#define REFRESH_COUNT 10000
+static void check_refresh_allocs(void) {
+	jack_port_t *out[REFRESH_PORTS], *in[REFRESH_PORTS];
+	char name[64];
+	unsigned int i, model_allocs = 0;
+	unsigned long heap = 0, server = 0;
+	GraphDiff d;
+
+	fixture_begin();
+	for (i = 0; i < REFRESH_PORTS; i++) {
+		snprintf(name, sizeof(name), "fx_%u:out", i);
+		out[i] = mock_port(name, i % 4 ? JACK_DEFAULT_AUDIO_TYPE : JACK_DEFAULT_MIDI_TYPE, JackPortIsOutput);
+		snprintf(name, sizeof(name), "fx_%u:in", i);
+		in[i] = mock_port(name, i % 4 ? JACK_DEFAULT_AUDIO_TYPE : JACK_DEFAULT_MIDI_TYPE, JackPortIsInput);
+		if (i) mock_connect(out[i - 1], in[i]);
+	}
+
+	graph_diff_init(&d);
+	Graph* g = build();
+	for (i = 0; i < REFRESH_WARMUP + REFRESH_COUNT; i++) {
+		if (i == REFRESH_WARMUP) {
+			heap = heap_calls;
+			server = mock_allocs;
+		}
+		/* Something to show for every refresh */
+		if (i % 2) mock_disconnect(out[1], in[2]);
+		else mock_connect(out[1], in[2]);
+
+		Graph* n = build();
+		graph_diff(g, n, &d);
+		if (i >= REFRESH_WARMUP) model_allocs += n->heap_allocs;
+		graph_unref(g);
+		g = n;
+	}
+	heap = heap_calls - heap;
+	server = mock_allocs - server;
+	printf("  refresh: %u refreshes, %lu heap allocations, %lu of them server lists, %u model\n",
+		REFRESH_COUNT, heap, server, model_allocs);
+
+	free_graph_diff(&d);
+	graph_unref(g);
+	CHECK(model_allocs == 0);
+	CHECK(heap == server);
+}
+
+static Port* find_port(Graph* g, jack_port_t* jp) {
+	return get_port_by_id(g, port_id(jp));
+}
+
+#define SYSTEM_FLAGS (JackPortIsPhysical | JackPortIsTerminal)
+
+/* Hardware client does not pass its playback inputs to its capture
+ * outputs, chain through it is no loop */
+static void check_loops(void) {
+	Trace t;
+
+	fixture_begin();
+	jack_port_t* cap = mock_port("system:capture_1", JACK_DEFAULT_AUDIO_TYPE, JackPortIsOutput | SYSTEM_FLAGS);
+	jack_port_t* play = mock_port("system:playback_1", JACK_DEFAULT_AUDIO_TYPE, JackPortIsInput | SYSTEM_FLAGS);
+	jack_port_t* fx_in = mock_port("fx:in", JACK_DEFAULT_AUDIO_TYPE, JackPortIsInput);
+	jack_port_t* fx_out = mock_port("fx:out", JACK_DEFAULT_AUDIO_TYPE, JackPortIsOutput);
+	jack_port_t* a_in = mock_port("a:in", JACK_DEFAULT_AUDIO_TYPE, JackPortIsInput);
+	jack_port_t* a_out = mock_port("a:out", JACK_DEFAULT_AUDIO_TYPE, JackPortIsOutput);
+	jack_port_t* b_in = mock_port("b:in", JACK_DEFAULT_AUDIO_TYPE, JackPortIsInput);
+	jack_port_t* b_out = mock_port("b:out", JACK_DEFAULT_AUDIO_TYPE, JackPortIsOutput);
+	mock_connect(cap, fx_in);
+	mock_connect(fx_out, play);
+
+	trace_init(&t);
+	Graph* g = build();
+	CHECK(g->flow.looped_count == 0);
+	CHECK(! connect_makes_loop(&t, g, find_port(g, cap), find_port(g, play)));
+	CHECK(connect_makes_loop(&t, g, find_port(g, fx_out), find_port(g, fx_in)));
+
+	/* Batch closing loop by itself is flagged at its closing pair */
+	Port* out[2] = { find_port(g, a_out), find_port(g, b_out) };
+	Port* in[2] = { find_port(g, b_in), find_port(g, a_in) };
+	CHECK(! connect_makes_loop(&t, g, out[1], in[1]));
+	CHECK(connect_batch_makes_loop(&t, g, out, in, 2) == 1);
+	in[1] = find_port(g, play);
+	CHECK(connect_batch_makes_loop(&t, g, out, in, 2) == 2);
+
+	/* Loop between clients is still found, next to hardware */
+	mock_connect(a_out, b_in);
+	mock_connect(b_out, a_in);
+	mock_connect(cap, a_in);
+	Graph* n = build();
+	unsigned int i, looped = 0;
+	for (i = 0; i < n->con_count; i++)
+		looped += connection_looped(n, n->cons + i);
+	CHECK(n->flow.looped_count == 2);
+	CHECK(looped == 2);
+	CHECK(connect_makes_loop(&t, n, find_port(n, fx_out), find_port(n, fx_in)));
+	CHECK(! connect_makes_loop(&t, n, find_port(n, a_out), find_port(n, play)));
+
+	trace_free(&t);
+	graph_unref(n);
+	graph_unref(g);
+}
+
+/* Trace from capture ends at playback, it does not come back through
+ * system to its other captures */
+static void check_trace(void) {
+	Bitset marks = { NULL, 0, 0 };
+	Trace t;
+
+	fixture_begin();
+	jack_port_t* cap1 = mock_port("system:capture_1", JACK_DEFAULT_AUDIO_TYPE, JackPortIsOutput | SYSTEM_FLAGS);
+	jack_port_t* cap2 = mock_port("system:capture_2", JACK_DEFAULT_AUDIO_TYPE, JackPortIsOutput | SYSTEM_FLAGS);
+	jack_port_t* play = mock_port("system:playback_1", JACK_DEFAULT_AUDIO_TYPE, JackPortIsInput | SYSTEM_FLAGS);
+	jack_port_t* fx_in = mock_port("fx:in", JACK_DEFAULT_AUDIO_TYPE, JackPortIsInput);
+	jack_port_t* fx_out = mock_port("fx:out", JACK_DEFAULT_AUDIO_TYPE, JackPortIsOutput);
+	jack_port_t* rec_in = mock_port("rec:in", JACK_DEFAULT_AUDIO_TYPE, JackPortIsInput);
+	mock_connect(cap1, fx_in);
+	mock_connect(fx_out, play);
+	mock_connect(cap2, rec_in);
+
+	trace_init(&t);
+	Graph* g = build();
+	Port* base = g->ports;
+
+	bitset_resize(&marks, g->count);
+	trace_mark(&t, g, find_port(g, cap1), &marks);
+	CHECK(bitset_count(&marks) == 3);
+	CHECK(bitset_get(&marks, find_port(g, fx_in) - base));
+	CHECK(bitset_get(&marks, find_port(g, fx_out) - base));
+	CHECK(bitset_get(&marks, find_port(g, play) - base));
+
+	bitset_clear_all(&marks);
+	trace_mark(&t, g, find_port(g, play), &marks);
+	CHECK(bitset_count(&marks) == 3);
+	CHECK(bitset_get(&marks, find_port(g, fx_out) - base));
+	CHECK(bitset_get(&marks, find_port(g, fx_in) - base));
+	CHECK(bitset_get(&marks, find_port(g, cap1) - base));
+
+	bitset_free(&marks);
+	trace_free(&t);
+	graph_unref(g);
+}
+
+/* Selection follows ports and connections into new generation, list
+ * positions move when server order changes */
+static void check_selection(void) {
+	Window w[3];
+	Window* ports = w;
+	Window* cons = w + 1;
+	unsigned short audio = port_type_id(JACK_DEFAULT_AUDIO_TYPE);
+
+	fixture_begin();
+	jack_port_t* a = mock_port("a:out", JACK_DEFAULT_AUDIO_TYPE, JackPortIsOutput);
+	jack_port_t* b = mock_port("b:out", JACK_DEFAULT_AUDIO_TYPE, JackPortIsOutput);
+	jack_port_t* c = mock_port("c:out", JACK_DEFAULT_AUDIO_TYPE, JackPortIsOutput);
+	jack_port_t* in = mock_port("d:in", JACK_DEFAULT_AUDIO_TYPE, JackPortIsInput);
+	mock_connect(a, in);
+	mock_connect(c, in);
+
+	memset(w, 0, sizeof(w));
+	ports->type = WIN_PORTS;
+	cons->type = WIN_CONNECTIONS;
+
+	Graph* g = build();
+	Range r = select_ports(g, JackPortIsOutput, audio);
+	w_assign_list(ports, g->ports + r.start, r.count, sizeof(Port));
+	r = select_connections(g, audio);
+	w_assign_list(cons, g->cons + r.start, r.count, sizeof(Connection));
+
+	/* Pick c:out and both connections, cursor on b:out */
+	unsigned int pos;
+	for (pos = 0; pos < ports->count; pos++) {
+		Port* p = w_get_item(ports, pos);
+		if (p->jport == c) bitset_set(&ports->sel, pos, true);
+		if (p->jport == b) ports->index = pos;
+	}
+	bitset_set(&cons->sel, 0, true);
+	bitset_set(&cons->sel, 1, true);
+
+	/* Same count, items shift: e:out comes last, a:out goes */
+	mock_port("e:out", JACK_DEFAULT_AUDIO_TYPE, JackPortIsOutput);
+	mock_unregister(a);
+	Graph* n = build();
+
+	w_sel_save(ports);
+	w_sel_save(cons);
+	r = select_ports(n, JackPortIsOutput, audio);
+	w_assign_list(ports, n->ports + r.start, r.count, sizeof(Port));
+	r = select_connections(n, audio);
+	w_assign_list(cons, n->cons + r.start, r.count, sizeof(Connection));
+	unsigned int ports_gone = w_sel_restore(ports);
+	unsigned int cons_gone = w_sel_restore(cons);
+
+	void* items[4];
+	unsigned int sel = w_sel_collect(ports, items);
+	Port* cur = w_get_item(ports, ports->index);
+	Connection* con = cons->count ? w_get_item(cons, 0) : NULL;
+	CHECK(ports->count == 3);
+	CHECK(ports_gone == 0);
+	CHECK(sel == 1 && ((Port*) items[0])->jport == c);
+	CHECK(cur && cur->jport == b);
+	CHECK(cons->count == 1);
+	CHECK(cons_gone == 1);
+	CHECK(w_sel_count(cons) == 1 && con->out->jport == c);
+
+	w_cleanup(w);
+	graph_unref(n);
+	graph_unref(g);
+}
+
+/* Client selection takes run of current item, nothing around it */
+static void check_select_client(void) {
+	Window w[3];
+	Window* ports = w;
+	unsigned short audio = port_type_id(JACK_DEFAULT_AUDIO_TYPE);
+
+	fixture_begin();
+	mock_port("a:out_1", JACK_DEFAULT_AUDIO_TYPE, JackPortIsOutput);
+	jack_port_t* a2 = mock_port("a:out_2", JACK_DEFAULT_AUDIO_TYPE, JackPortIsOutput);
+	mock_port("b:out", JACK_DEFAULT_AUDIO_TYPE, JackPortIsOutput);
+
+	memset(w, 0, sizeof(w));
+	ports->type = WIN_PORTS;
+
+	Graph* g = build();
+	Range r = select_ports(g, JackPortIsOutput, audio);
+	w_assign_list(ports, g->ports + r.start, r.count, sizeof(Port));
+	ports->index = find_port(g, a2) - (g->ports + r.start);
+	w_sel_run(ports);
+
+	void* items[4];
+	unsigned int sel = w_sel_collect(ports, items);
+	CHECK(sel == 2);
+	CHECK(((Port*) items[0])->client == ((Port*) items[1])->client);
+	CHECK(((Port*) items[1])->jport == a2);
+
+	w_cleanup(w);
+	graph_unref(g);
+}
+
+int main(void) {
+	port_type_id(JACK_DEFAULT_AUDIO_TYPE);
+	port_type_id(JACK_DEFAULT_MIDI_TYPE);
+
+	check_scale();
+	check_add_ports();
+	check_remove_ports();
+	check_churn_clones();
+	check_refresh_allocs();
+	check_selection();
+	check_select_client();
+	check_loops();
+	check_trace();
+	graph_free_spare();
+	arena_free(&scratch);
+
+	if (failures) {
+		fprintf(stderr, "%u checks failed\n", failures);
+		return 1;
+	}
+	printf("all checks passed\n");
+	return 0;
+}
@@ -0,0 +1,127 @@
+#include <signal.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <jack/jack.h>
+
+/* Churn client for stress runs against real server: registers ports,
+ * connects, disconnects and unregisters them at given rate, then
+ * leaves graph as it found it.
+ *
+ * churn [-n NAME] [-r CHANGES_PER_SEC] [-p PORTS] [-t SECONDS] [-c PORT] */
+
+#define MAX_PORTS 256
+
+static volatile sig_atomic_t running = 1;
+
+static void stop(int sig) {
+	running = 0;
+}
+
+static double now_s(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* First input of other client, playback usually */
+static char* pick_target(jack_client_t* client, const char* me) {
+	const char** ports = jack_get_ports(client, NULL, JACK_DEFAULT_AUDIO_TYPE, JackPortIsInput);
+	size_t len = strlen(me);
+	char* ret = NULL;
+	unsigned int i;
+
+	for (i = 0; ports && ports[i]; i++) {
+		if (strncmp(ports[i], me, len) == 0 && ports[i][len] == ':') continue;
+		ret = strdup(ports[i]);
+		break;
+	}
+	jack_free(ports);
+	return ret;
+}
+
+int main(int argc, char* argv[]) {
+	const char* name = "churn";
+	char* target = NULL;
+	double rate = 50, seconds = 10;
+	unsigned int count = 4;
+	jack_port_t* ports[MAX_PORTS];
+	char port_name[32];
+	jack_status_t status;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "n:r:p:t:c:")) != -1) {
+		switch (opt) {
+			case 'n': name = optarg; break;
+			case 'r': rate = atof(optarg); break;
+			case 'p': count = atoi(optarg); break;
+			case 't': seconds = atof(optarg); break;
+			case 'c': target = strdup(optarg); break;
+			default:
+				fprintf(stderr, "usage: %s [-n NAME] [-r CHANGES_PER_SEC] [-p PORTS] [-t SECONDS] [-c PORT]\n", argv[0]);
+				return 2;
+		}
+	}
+	if (count < 1 || count > MAX_PORTS || rate <= 0) {
+		fprintf(stderr, "churn: 1 to %d ports, rate above 0\n", MAX_PORTS);
+		return 2;
+	}
+
+	jack_client_t* client = jack_client_open(name, JackUseExactName, &status);
+	if (! client) {
+		fprintf(stderr, "churn: can not connect to server, status 0x%x\n", status);
+		return 1;
+	}
+	if (jack_activate(client)) {
+		fprintf(stderr, "churn: can not activate\n");
+		jack_client_close(client);
+		return 1;
+	}
+	if (! target) target = pick_target(client, name);
+
+	signal(SIGINT, stop);
+	signal(SIGTERM, stop);
+
+	/* Rounds of register all, connect all, disconnect all, unregister all.
+	 * Round in progress is finished, so nothing is left behind */
+	double start = now_s(), period = 1 / rate;
+	unsigned long changes = 0, failed = 0, step = 0;
+	while (true) {
+		unsigned int phase = step / count % 4;
+		unsigned int p = step % count;
+
+		if (phase == 0 && p == 0 && (! running || now_s() - start >= seconds)) break;
+		switch (phase) {
+			case 0:
+				snprintf(port_name, sizeof(port_name), "out_%u", p);
+				ports[p] = jack_port_register(client, port_name, JACK_DEFAULT_AUDIO_TYPE, JackPortIsOutput, 0);
+				failed += ! ports[p];
+				break;
+			case 1:
+				if (ports[p] && target)
+					failed += jack_connect(client, jack_port_name(ports[p]), target) != 0;
+				break;
+			case 2:
+				if (ports[p] && target)
+					failed += jack_disconnect(client, jack_port_name(ports[p]), target) != 0;
+				break;
+			case 3:
+				if (ports[p]) jack_port_unregister(client, ports[p]);
+				break;
+		}
+		changes++;
+		step++;
+
+		double next = start + changes * period - now_s();
+		if (next > 0) usleep(next * 1e6);
+	}
+
+	printf("churn %s: %lu changes in %.1f s, %lu failed\n", name, changes, now_s() - start, failed);
+	jack_client_close(client);
+	free(target);
+	return 0;
+}
@@ -0,0 +1,649 @@
+#include <errno.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <jack/jack.h>
+#include <jack/midiport.h>
+#include <jack/uuid.h>
+
+#include "mockjack.h"
+
+#define MOCK_RATE 48000
+#define MOCK_PERIOD 256
+#define MOCK_NAME 320
+
+struct _jack_port {
+	char name[MOCK_NAME];
+	const char* type;
+	unsigned long flags;
+	jack_port_id_t id;
+	bool live;
+	bool mine;
+	jack_nframes_t latency[2]; /* capture, playback */
+	unsigned int* peers;       /* port ids */
+	unsigned int peer_count;
+	unsigned int peer_cap;
+	float* buf;
+};
+
+struct _jack_client {
+	int dummy;
+};
+
+unsigned long mock_calls;
+unsigned long mock_allocs;
+
+static struct _jack_client client;
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static jack_port_t** ports;
+static unsigned int port_count, port_cap;
+static unsigned int* free_ids; /* of unregistered ports, reused as server does */
+static unsigned int free_count, free_cap;
+static jack_port_t** names; /* open addressing by name, live ports */
+static unsigned int names_cap, names_used;
+
+static JackProcessCallback process_cb;
+static JackPortRegistrationCallback reg_cb;
+static JackPortConnectCallback connect_cb;
+static JackPortRenameCallback rename_cb;
+static JackGraphOrderCallback order_cb;
+static JackLatencyCallback latency_cb;
+static JackXRunCallback xrun_cb;
+static void *process_arg, *reg_arg, *connect_arg, *rename_arg, *order_arg, *latency_arg, *xrun_arg;
+
+static pthread_t thread;
+static volatile bool running;
+static jack_nframes_t latency_extra;
+
+static int env_int(const char* name, int def) {
+	const char* s = getenv(name);
+	return s ? atoi(s) : def;
+}
+
+/* NAMES */
+static unsigned int hash_name(const char* s) {
+	unsigned int h = 2166136261u;
+	while (*s) {
+		h ^= (unsigned char) *s++;
+		h *= 16777619u;
+	}
+	return h;
+}
+
+static void names_insert(jack_port_t* p) {
+	unsigned int h = hash_name(p->name) & (names_cap - 1);
+	while (names[h]) h = (h + 1) & (names_cap - 1);
+	names[h] = p;
+	names_used++;
+}
+
+/* Unregistered ports stay in table until it is rebuilt, lookups skip
+ * them. Size goes by live ports, so churn does not grow it */
+static void names_grow(void) {
+	unsigned int i, live = 0;
+
+	if (2 * (names_used + 1) <= names_cap) return;
+	for (i = 0; i < port_count; i++)
+		live += ports[i]->live;
+	free(names);
+	names_cap = 64;
+	while (names_cap < 4 * (live + 1)) names_cap *= 2;
+	names = calloc(names_cap, sizeof(jack_port_t*));
+	names_used = 0;
+	for (i = 0; i < port_count; i++)
+		if (ports[i]->live) names_insert(ports[i]);
+}
+
+static jack_port_t* find_port(const char* name) {
+	unsigned int h;
+
+	if (! names_cap) return NULL;
+	for (h = hash_name(name) & (names_cap - 1); names[h]; h = (h + 1) & (names_cap - 1))
+		if (names[h]->live && strcmp(names[h]->name, name) == 0) return names[h];
+	return NULL;
+}
+
+static bool custom_type(const char* type) {
+	return strcmp(type, JACK_DEFAULT_MIDI_TYPE) && strcmp(type, JACK_DEFAULT_AUDIO_TYPE);
+}
+
+/* SERVER STATE, called with lock held */
+static jack_port_t* add_port(const char* name, const char* type, unsigned long flags) {
+	jack_port_t* p;
+
+	/* Slot and id of unregistered port, handle stays valid and names
+	 * the new port, as with shared port table of server */
+	if (free_count) {
+		p = ports[free_ids[--free_count]];
+		if (custom_type(p->type)) free((char*) p->type);
+		p->mine = false;
+		memset(p->latency, 0, sizeof(p->latency));
+	} else {
+		if (port_count == port_cap) {
+			port_cap = port_cap ? 2 * port_cap : 64;
+			ports = realloc(ports, port_cap * sizeof(jack_port_t*));
+		}
+		p = calloc(1, sizeof(jack_port_t));
+		p->id = port_count;
+		ports[port_count++] = p;
+	}
+	snprintf(p->name, MOCK_NAME, "%s", name);
+	p->type = strcmp(type, JACK_DEFAULT_MIDI_TYPE) == 0 ? JACK_DEFAULT_MIDI_TYPE :
+		strcmp(type, JACK_DEFAULT_AUDIO_TYPE) == 0 ? JACK_DEFAULT_AUDIO_TYPE : strdup(type);
+	p->flags = flags;
+	p->live = true;
+
+	names_grow();
+	names_insert(p);
+	return p;
+}
+
+static void peer_add(jack_port_t* p, unsigned int id) {
+	if (p->peer_count == p->peer_cap) {
+		p->peer_cap = p->peer_cap ? 2 * p->peer_cap : 4;
+		p->peers = realloc(p->peers, p->peer_cap * sizeof(unsigned int));
+	}
+	p->peers[p->peer_count++] = id;
+}
+
+static bool peer_remove(jack_port_t* p, unsigned int id) {
+	unsigned int i;
+	for (i = 0; i < p->peer_count; i++) {
+		if (p->peers[i] == id) {
+			p->peers[i] = p->peers[--p->peer_count];
+			return true;
+		}
+	}
+	return false;
+}
+
+static int link_ports(jack_port_t* out, jack_port_t* in) {
+	unsigned int i;
+
+	if (! out->live || ! in->live) return -1;
+	if (! (out->flags & JackPortIsOutput) || ! (in->flags & JackPortIsInput)) return -1;
+	if (out->type != in->type && strcmp(out->type, in->type) != 0) return -1;
+	for (i = 0; i < out->peer_count; i++)
+		if (out->peers[i] == in->id) return EEXIST;
+	peer_add(out, in->id);
+	peer_add(in, out->id);
+	return 0;
+}
+
+static bool unlink_ports(jack_port_t* out, jack_port_t* in) {
+	if (! peer_remove(out, in->id)) return false;
+	peer_remove(in, out->id);
+	return true;
+}
+
+/* NOTIFICATIONS, called without lock */
+static void notify_reg(jack_port_t* p, int reg) {
+	if (reg_cb) reg_cb(p->id, reg, reg_arg);
+	if (order_cb) order_cb(order_arg);
+}
+
+static void notify_connect(jack_port_t* out, jack_port_t* in, int connect) {
+	if (connect_cb) connect_cb(out->id, in->id, connect, connect_arg);
+	if (order_cb) order_cb(order_arg);
+}
+
+/* CONTROL */
+jack_port_t* mock_port(const char* name, const char* type, unsigned long flags) {
+	pthread_mutex_lock(&lock);
+	jack_port_t* p = add_port(name, type, flags);
+	pthread_mutex_unlock(&lock);
+	notify_reg(p, 1);
+	return p;
+}
+
+void mock_unregister(jack_port_t* p) {
+	unsigned int gone[64];
+	unsigned int i, n = 0;
+
+	pthread_mutex_lock(&lock);
+	if (! p->live) {
+		pthread_mutex_unlock(&lock);
+		return;
+	}
+	p->live = false;
+	while (p->peer_count) {
+		jack_port_t* peer = ports[p->peers[0]];
+		if ((p->flags & JackPortIsOutput) ? unlink_ports(p, peer) : unlink_ports(peer, p))
+			if (n < 64) gone[n++] = peer->id;
+	}
+	pthread_mutex_unlock(&lock);
+
+	for (i = 0; i < n; i++) {
+		jack_port_t* peer = ports[gone[i]];
+		if (connect_cb) connect_cb((p->flags & JackPortIsOutput) ? p->id : peer->id,
+			(p->flags & JackPortIsOutput) ? peer->id : p->id, 0, connect_arg);
+	}
+	notify_reg(p, 0);
+
+	/* Free for reuse once everybody was told */
+	pthread_mutex_lock(&lock);
+	if (free_count == free_cap) {
+		free_cap = free_cap ? 2 * free_cap : 64;
+		free_ids = realloc(free_ids, free_cap * sizeof(unsigned int));
+	}
+	free_ids[free_count++] = p->id;
+	pthread_mutex_unlock(&lock);
+}
+
+int mock_connect(jack_port_t* out, jack_port_t* in) {
+	pthread_mutex_lock(&lock);
+	int ret = link_ports(out, in);
+	pthread_mutex_unlock(&lock);
+	if (ret == 0) notify_connect(out, in, 1);
+	return ret;
+}
+
+int mock_disconnect(jack_port_t* out, jack_port_t* in) {
+	pthread_mutex_lock(&lock);
+	bool ret = unlink_ports(out, in);
+	pthread_mutex_unlock(&lock);
+	if (ret) notify_connect(out, in, 0);
+	return ret ? 0 : -1;
+}
+
+void mock_latency(jack_port_t* p, jack_latency_callback_mode_t mode, jack_nframes_t latency) {
+	p->latency[mode == JackCaptureLatency ? 0 : 1] = latency;
+}
+
+void mock_reset(void) {
+	unsigned int i;
+
+	for (i = 0; i < port_count; i++) {
+		if (custom_type(ports[i]->type)) free((char*) ports[i]->type);
+		free(ports[i]->peers);
+		free(ports[i]->buf);
+		free(ports[i]);
+	}
+	free(ports);
+	free(names);
+	free(free_ids);
+	ports = names = NULL;
+	free_ids = NULL;
+	port_count = port_cap = names_cap = names_used = 0;
+	free_count = free_cap = 0;
+	mock_calls = 0;
+	mock_allocs = 0;
+}
+
+/* Clients client_K with audio and MIDI ins and outs, outputs of each
+ * one feed next one. Physical system ports feed first client and
+ * take last one */
+static void mock_setup(void) {
+	int clients = env_int("MOCKJACK_CLIENTS", 5);
+	int audio = env_int("MOCKJACK_AUDIO", 2);
+	int midi = env_int("MOCKJACK_MIDI", 1);
+	jack_port_t *prev[64], *cur[64];
+	char name[MOCK_NAME];
+	int k, i, n = 0;
+
+	if (audio + midi > 64) midi = 64 - audio;
+	if (env_int("MOCKJACK_SYSTEM", 1)) {
+		for (i = 0; i < audio; i++) {
+			snprintf(name, sizeof(name), "system:capture_%d", i + 1);
+			prev[n++] = add_port(name, JACK_DEFAULT_AUDIO_TYPE,
+				JackPortIsOutput | JackPortIsPhysical | JackPortIsTerminal);
+		}
+	}
+
+	for (k = 0; k < clients; k++) {
+		for (i = 0; i < audio + midi; i++) {
+			const char* type = i < audio ? JACK_DEFAULT_AUDIO_TYPE : JACK_DEFAULT_MIDI_TYPE;
+			snprintf(name, sizeof(name), "client_%d:%s_%d", k, i < audio ? "in" : "midi_in",
+				i < audio ? i : i - audio);
+			jack_port_t* in = add_port(name, type, JackPortIsInput);
+			if (i < n) link_ports(prev[i], in);
+		}
+		for (i = 0; i < audio + midi; i++) {
+			const char* type = i < audio ? JACK_DEFAULT_AUDIO_TYPE : JACK_DEFAULT_MIDI_TYPE;
+			snprintf(name, sizeof(name), "client_%d:%s_%d", k, i < audio ? "out" : "midi_out",
+				i < audio ? i : i - audio);
+			cur[i] = add_port(name, type, JackPortIsOutput);
+		}
+		memcpy(prev, cur, sizeof(cur));
+		n = audio + midi;
+	}
+
+	if (env_int("MOCKJACK_SYSTEM", 1)) {
+		for (i = 0; i < audio; i++) {
+			snprintf(name, sizeof(name), "system:playback_%d", i + 1);
+			jack_port_t* in = add_port(name, JACK_DEFAULT_AUDIO_TYPE,
+				JackPortIsInput | JackPortIsPhysical | JackPortIsTerminal);
+			if (clients) link_ports(prev[i], in);
+		}
+	}
+
+	/* Last client back into first one */
+	if (clients > 1 && audio && env_int("MOCKJACK_CYCLE", 0)) {
+		snprintf(name, sizeof(name), "client_%d:out_0", clients - 1);
+		jack_port_t* out = find_port(name);
+		link_ports(out, find_port("client_0:in_0"));
+	}
+}
+
+/* One step of port life: register, connect, disconnect, unregister */
+static void mock_churn(unsigned long step) {
+	static jack_port_t* late;
+	char name[64];
+
+	switch (step % 4) {
+	case 0:
+		snprintf(name, sizeof(name), "late:out_%lu", step / 4);
+		late = mock_port(name, JACK_DEFAULT_AUDIO_TYPE, JackPortIsOutput);
+		break;
+	case 1:
+		mock_connect(late, find_port("client_0:in_0"));
+		break;
+	case 2:
+		mock_disconnect(late, find_port("client_0:in_0"));
+		break;
+	case 3:
+		mock_unregister(late);
+		break;
+	}
+}
+
+/* Ports and connections as jack_lsp -c lists them */
+static void mock_list(const char* path) {
+	unsigned int i, k;
+
+	FILE* f = fopen(path, "w");
+	if (! f) return;
+	pthread_mutex_lock(&lock);
+	for (i = 0; i < port_count; i++) {
+		if (! ports[i]->live) continue;
+		fprintf(f, "%s\n", ports[i]->name);
+		for (k = 0; k < ports[i]->peer_count; k++)
+			fprintf(f, "   %s\n", ports[ports[i]->peers[k]]->name);
+	}
+	pthread_mutex_unlock(&lock);
+	fclose(f);
+}
+
+/* Process cycles in real time, with optional graph changes. Churn
+ * waits for MOCKJACK_CHURN_AFTER file when given, graph is listed to
+ * MOCKJACK_LSP.before and .after around it */
+static void* mock_thread(void* arg) {
+	unsigned long cycle = 0, steps = 0;
+	int churn = env_int("MOCKJACK_CHURN", 0); /* changes per second */
+	int churn_for = env_int("MOCKJACK_CHURN_SECONDS", 0); /* then back to start */
+	const char* gate = getenv("MOCKJACK_CHURN_AFTER");
+	const char* lsp = getenv("MOCKJACK_LSP");
+	int xrun = env_int("MOCKJACK_XRUN", 0);
+	int latency = env_int("MOCKJACK_LATENCY", 0);
+	unsigned int cycles_per_sec = MOCK_RATE / MOCK_PERIOD;
+	bool listed = false;
+	char path[512];
+	struct timespec start, now;
+
+	/* Cycles oversleep, churn goes by clock */
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	while (running) {
+		usleep(1000000 / cycles_per_sec);
+		if (process_cb) process_cb(MOCK_PERIOD, process_arg);
+		cycle++;
+
+		if (xrun && xrun_cb && cycle % (2 * cycles_per_sec) == 0)
+			xrun_cb(xrun_arg);
+		if (latency && latency_cb && cycle % (4 * cycles_per_sec) == 0) {
+			latency_extra += 64;
+			latency_cb(JackCaptureLatency, latency_arg);
+			latency_cb(JackPlaybackLatency, latency_arg);
+		}
+		if (! churn) continue;
+		if (gate) {
+			if (access(gate, F_OK)) continue;
+			gate = NULL;
+			if (lsp) {
+				snprintf(path, sizeof(path), "%s.before", lsp);
+				mock_list(path);
+			}
+			clock_gettime(CLOCK_MONOTONIC, &start);
+		}
+
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		double elapsed = (now.tv_sec - start.tv_sec) + (now.tv_nsec - start.tv_nsec) / 1e9;
+		bool churning = ! churn_for || elapsed < churn_for;
+		while (steps < elapsed * churn && (churning || steps % 4))
+			mock_churn(steps++);
+		if (! churning && steps % 4 == 0 && lsp && ! listed) {
+			snprintf(path, sizeof(path), "%s.after", lsp);
+			mock_list(path);
+			listed = true;
+		}
+	}
+	return NULL;
+}
+
+/* CLIENT API */
+jack_client_t* jack_client_open(const char* name, jack_options_t options, jack_status_t* status, ...) {
+	if (env_int("MOCKJACK_FAIL", 0)) {
+		if (status) *status = JackServerFailed | JackFailure;
+		return NULL;
+	}
+	pthread_mutex_lock(&lock);
+	mock_setup();
+	pthread_mutex_unlock(&lock);
+	if (status) *status = 0;
+	return &client;
+}
+
+int jack_client_close(jack_client_t* c) {
+	return 0;
+}
+
+int jack_activate(jack_client_t* c) {
+	running = true;
+	return pthread_create(&thread, NULL, mock_thread, NULL);
+}
+
+int jack_deactivate(jack_client_t* c) {
+	if (running) {
+		running = false;
+		pthread_join(thread, NULL);
+	}
+	return 0;
+}
+
+int jack_is_realtime(jack_client_t* c) { return 1; }
+jack_nframes_t jack_get_sample_rate(jack_client_t* c) { return MOCK_RATE; }
+jack_nframes_t jack_get_buffer_size(jack_client_t* c) { return MOCK_PERIOD; }
+float jack_cpu_load(jack_client_t* c) { mock_calls++; return 3.5f; }
+float jack_get_xrun_delayed_usecs(jack_client_t* c) { return 120.0f; }
+void jack_set_error_function(void (*func)(const char*)) {}
+void jack_set_info_function(void (*func)(const char*)) {}
+void jack_on_shutdown(jack_client_t* c, JackShutdownCallback cb, void* arg) {}
+void jack_free(void* ptr) { free(ptr); }
+int jack_port_name_size(void) { return MOCK_NAME; }
+int jack_port_type_size(void) { return 32; }
+int jack_recompute_total_latencies(jack_client_t* c) { return 0; }
+
+jack_time_t jack_get_time(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+}
+
+int jack_set_process_callback(jack_client_t* c, JackProcessCallback cb, void* arg) {
+	process_cb = cb; process_arg = arg; return 0;
+}
+int jack_set_graph_order_callback(jack_client_t* c, JackGraphOrderCallback cb, void* arg) {
+	order_cb = cb; order_arg = arg; return 0;
+}
+int jack_set_xrun_callback(jack_client_t* c, JackXRunCallback cb, void* arg) {
+	xrun_cb = cb; xrun_arg = arg; return 0;
+}
+int jack_set_port_registration_callback(jack_client_t* c, JackPortRegistrationCallback cb, void* arg) {
+	reg_cb = cb; reg_arg = arg; return 0;
+}
+int jack_set_port_connect_callback(jack_client_t* c, JackPortConnectCallback cb, void* arg) {
+	connect_cb = cb; connect_arg = arg; return 0;
+}
+int jack_set_port_rename_callback(jack_client_t* c, JackPortRenameCallback cb, void* arg) {
+	rename_cb = cb; rename_arg = arg; return 0;
+}
+int jack_set_latency_callback(jack_client_t* c, JackLatencyCallback cb, void* arg) {
+	latency_cb = cb; latency_arg = arg; return 0;
+}
+int jack_set_buffer_size_callback(jack_client_t* c, JackBufferSizeCallback cb, void* arg) { return 0; }
+int jack_set_sample_rate_callback(jack_client_t* c, JackSampleRateCallback cb, void* arg) { return 0; }
+int jack_set_client_registration_callback(jack_client_t* c, JackClientRegistrationCallback cb, void* arg) { return 0; }
+
+/* Name lists are copies in one block, as server hands them out */
+static const char** name_list(jack_port_t** list, unsigned int count) {
+	size_t size = (count + 1) * sizeof(char*);
+	unsigned int i;
+
+	if (! count) return NULL;
+	for (i = 0; i < count; i++)
+		size += strlen(list[i]->name) + 1;
+
+	const char** ret = malloc(size);
+	mock_allocs++;
+	char* s = (char*) (ret + count + 1);
+	for (i = 0; i < count; i++) {
+		ret[i] = s;
+		s = stpcpy(s, list[i]->name) + 1;
+	}
+	ret[count] = NULL;
+	return ret;
+}
+
+const char** jack_get_ports(jack_client_t* c, const char* name_pattern, const char* type_pattern, unsigned long flags) {
+	unsigned int i, n = 0;
+
+	mock_calls++;
+	pthread_mutex_lock(&lock);
+	jack_port_t** list = malloc((port_count + 1) * sizeof(jack_port_t*));
+	mock_allocs++;
+	for (i = 0; i < port_count; i++)
+		if (ports[i]->live && (! flags || (ports[i]->flags & flags)))
+			list[n++] = ports[i];
+	const char** ret = name_list(list, n);
+	pthread_mutex_unlock(&lock);
+	free(list);
+	return ret;
+}
+
+const char** jack_port_get_all_connections(const jack_client_t* c, const jack_port_t* p) {
+	unsigned int i;
+
+	mock_calls++;
+	pthread_mutex_lock(&lock);
+	jack_port_t** list = malloc((p->peer_count + 1) * sizeof(jack_port_t*));
+	mock_allocs++;
+	for (i = 0; i < p->peer_count; i++)
+		list[i] = ports[p->peers[i]];
+	const char** ret = name_list(list, p->peer_count);
+	pthread_mutex_unlock(&lock);
+	free(list);
+	return ret;
+}
+
+const char** jack_port_get_connections(const jack_port_t* p) {
+	return jack_port_get_all_connections(&client, p);
+}
+
+int jack_port_connected(const jack_port_t* p) { return p->peer_count; }
+
+jack_port_t* jack_port_by_name(jack_client_t* c, const char* name) {
+	static unsigned int race;
+
+	mock_calls++;
+	/* Port gone between listing and lookup */
+	if (env_int("MOCKJACK_RACE", 0) && ++race % 20 == 0) return NULL;
+	pthread_mutex_lock(&lock);
+	jack_port_t* p = find_port(name);
+	pthread_mutex_unlock(&lock);
+	return p;
+}
+
+jack_port_t* jack_port_by_id(jack_client_t* c, jack_port_id_t id) {
+	mock_calls++;
+	pthread_mutex_lock(&lock);
+	jack_port_t* p = id < port_count && ports[id]->live ? ports[id] : NULL;
+	pthread_mutex_unlock(&lock);
+	return p;
+}
+
+const char* jack_port_name(const jack_port_t* p) { return p->name; }
+const char* jack_port_short_name(const jack_port_t* p) { return strchr(p->name, ':') + 1; }
+int jack_port_flags(const jack_port_t* p) { return p->flags; }
+const char* jack_port_type(const jack_port_t* p) { return p->type; }
+int jack_port_is_mine(const jack_client_t* c, const jack_port_t* p) { return p->mine; }
+jack_uuid_t jack_port_uuid(const jack_port_t* p) { return 0x200000000ULL | (p->id + 1); }
+uint32_t jack_uuid_to_index(jack_uuid_t u) { return (uint32_t) (u & 0xffffffff) - 1; }
+int jack_uuid_empty(jack_uuid_t u) { return u == 0; }
+
+void jack_port_get_latency_range(jack_port_t* p, jack_latency_callback_mode_t mode, jack_latency_range_t* range) {
+	mock_calls++;
+	range->min = range->max = p->latency[mode == JackCaptureLatency ? 0 : 1] +
+		(p->flags & JackPortIsPhysical ? latency_extra : 0);
+}
+
+jack_port_t* jack_port_register(jack_client_t* c, const char* name, const char* type, unsigned long flags, unsigned long size) {
+	char full[MOCK_NAME];
+
+	snprintf(full, sizeof(full), "njconnect:%s", name);
+	pthread_mutex_lock(&lock);
+	jack_port_t* p = add_port(full, type, flags);
+	p->mine = true;
+	pthread_mutex_unlock(&lock);
+	notify_reg(p, 1);
+	return p;
+}
+
+int jack_port_unregister(jack_client_t* c, jack_port_t* p) {
+	mock_unregister(p);
+	return 0;
+}
+
+int jack_connect(jack_client_t* c, const char* src, const char* dst) {
+	mock_calls++;
+	pthread_mutex_lock(&lock);
+	jack_port_t* out = find_port(src);
+	jack_port_t* in = find_port(dst);
+	pthread_mutex_unlock(&lock);
+	if (! out || ! in) return -1;
+	return mock_connect(out, in);
+}
+
+int jack_disconnect(jack_client_t* c, const char* src, const char* dst) {
+	mock_calls++;
+	pthread_mutex_lock(&lock);
+	jack_port_t* out = find_port(src);
+	jack_port_t* in = find_port(dst);
+	pthread_mutex_unlock(&lock);
+	if (! out || ! in) return -1;
+	return mock_disconnect(out, in);
+}
+
+int jack_port_disconnect(jack_client_t* c, jack_port_t* p) {
+	while (p->peer_count) {
+		jack_port_t* peer = ports[p->peers[0]];
+		if (p->flags & JackPortIsOutput) mock_disconnect(p, peer);
+		else mock_disconnect(peer, p);
+	}
+	return 0;
+}
+
+/* Noise, so meters have something to show */
+void* jack_port_get_buffer(jack_port_t* p, jack_nframes_t nframes) {
+	jack_nframes_t i;
+	if (! p->buf) p->buf = calloc(8192, sizeof(float));
+	for (i = 0; i < nframes && i < 8192; i++)
+		p->buf[i] = (float) (rand() % 2000 - 1000) / 2000.0f;
+	return p->buf;
+}
+
+uint32_t jack_midi_get_event_count(void* buf) { return rand() % 3; }
+int jack_midi_event_get(jack_midi_event_t* event, void* buf, uint32_t index) { return -1; }
+void jack_midi_clear_buffer(void* buf) {}
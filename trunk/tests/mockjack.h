@@ -0,0 +1,19 @@
+#ifndef MOCKJACK_H
+#define MOCKJACK_H
+
+#include <jack/jack.h>
+
+/* In process stand-in for Jack server, for tests and benchmarks.
+ * Linked into test programs, or built as libjack.so for njconnect */
+
+extern unsigned long mock_calls; /* server queries made by client */
+extern unsigned long mock_allocs; /* heap blocks server side took for them */
+
+jack_port_t* mock_port(const char* name, const char* type, unsigned long flags);
+void mock_unregister(jack_port_t* p);
+int mock_connect(jack_port_t* out, jack_port_t* in);
+int mock_disconnect(jack_port_t* out, jack_port_t* in);
+void mock_latency(jack_port_t* p, jack_latency_callback_mode_t mode, jack_nframes_t latency);
+void mock_reset(void);
+
+#endif /* MOCKJACK_H */
@@ -0,0 +1,184 @@
+#!/bin/sh
+# Stress run: njconnect on a pty while clients churn the graph.
+# Uses jackd with dummy driver when it and jack_lsp are installed, mock
+# server otherwise or when STRESS_MOCK=1. Run from trunk, after make.
+#
+# Churn starts once njconnect is warm and leaves the graph as it found
+# it. Reports event to screen latency from trace, late updates, lost
+# updates (server lists before and after churn differ, or graph njconnect
+# shows at end differs from the one at start), memory growth in second
+# half of churn and crashes. Fails when one is over limit.
+
+SECONDS_RUN=${STRESS_SECONDS:-20}   # churn time
+CLIENTS=${STRESS_CLIENTS:-4}        # churn clients at once
+RATE=${STRESS_RATE:-50}             # changes per second of each
+PORTS=${STRESS_PORTS:-8}            # ports of each churn client
+LIFE=${STRESS_LIFE:-5}              # seconds before client is replaced
+LATE_MS=${STRESS_LATE_MS:-50}       # event to screen slower is late
+MAX_LATE=${STRESS_MAX_LATE:-0}
+MAX_GROWTH_KB=${STRESS_MAX_GROWTH_KB:-256}
+
+WARM=2
+DIR=$(mktemp -d /tmp/njstress.XXXXXX)
+TRACE=$DIR/trace.json
+KEYS=$DIR/stress.keys
+OUT=$DIR/bench.out
+LSP=$DIR/lsp
+JACKD=
+CHURNS=
+BENCH=
+
+cleanup() {
+	[ -n "$CHURNS" ] && kill $CHURNS 2>/dev/null
+	[ -n "$BENCH" ] && kill $BENCH 2>/dev/null
+	[ -n "$JACKD" ] && kill $JACKD 2>/dev/null
+	wait 2>/dev/null
+}
+trap cleanup EXIT INT TERM
+
+# Keys: warm up, hold through churn in two halves, settle, move, quit.
+# No refresh: full rebuild would cover lost updates
+HALF=$(( SECONDS_RUN / 2 ))
+cat > "$KEYS" <<EOF
+start    -                  - - 2000
+warm     @$WARM             - - -
+churn    @$HALF             - - -
+churn2   @$(( SECONDS_RUN - HALF ))  - - -
+settle   @3                 - - -
+down     j                  - - -
+EOF
+
+# Churn waits until warm step is reported
+wait_warm() {
+	while ! grep -q '^warm ' "$OUT" 2>/dev/null; do
+		kill -0 $BENCH 2>/dev/null || return 1
+		sleep 0.1
+	done
+}
+
+if [ -z "${STRESS_MOCK:-}" ] && command -v jackd >/dev/null && command -v jack_lsp >/dev/null; then
+	echo "stress: jackd dummy driver, $CLIENTS clients of $RATE changes/s for $SECONDS_RUN s"
+	jackd --no-realtime -n njstress -d dummy -r 48000 -p 256 >"$DIR/jackd.log" 2>&1 &
+	JACKD=$!
+	export JACK_DEFAULT_SERVER=njstress
+	sleep 1
+
+	./tests/bench_render "$KEYS" ./njconnect --trace "$TRACE" > "$OUT" &
+	BENCH=$!
+	if wait_warm; then
+		jack_lsp -c > "$LSP.before"
+
+		# Clients come and go for the whole run, each leaves nothing behind
+		end=$(( $(date +%s) + SECONDS_RUN ))
+		i=0
+		while [ $i -lt "$CLIENTS" ]; do
+			(
+				n=0
+				while [ "$(date +%s)" -lt $end ]; do
+					left=$(( end - $(date +%s) ))
+					[ $left -gt "$LIFE" ] && left=$LIFE
+					./tests/churn -n "churn_${i}_$n" -r "$RATE" -p "$PORTS" -t $left >/dev/null
+					n=$(( n + 1 ))
+				done
+			) &
+			CHURNS="$CHURNS $!"
+			i=$(( i + 1 ))
+		done
+		wait $CHURNS
+		CHURNS=
+		jack_lsp -c > "$LSP.after"
+	fi
+	wait $BENCH
+	status=$?
+else
+	echo "stress: mock server, $(( CLIENTS * RATE )) changes/s for $SECONDS_RUN s"
+	env LD_PRELOAD=./tests/libmockjack.so MOCKJACK_CLIENTS=40 \
+		MOCKJACK_CHURN=$(( CLIENTS * RATE )) MOCKJACK_CHURN_SECONDS=$SECONDS_RUN \
+		MOCKJACK_CHURN_AFTER="$DIR/go" MOCKJACK_LSP="$LSP" MOCKJACK_XRUN=1 \
+		./tests/bench_render "$KEYS" ./njconnect --trace "$TRACE" > "$OUT" &
+	BENCH=$!
+	wait_warm && touch "$DIR/go"
+	wait $BENCH
+	status=$?
+fi
+BENCH=
+cat "$OUT"
+
+fail=0
+if [ $status -ne 0 ]; then
+	echo "stress: FAIL crashed or did not quit cleanly (status $status)"
+	fail=1
+fi
+if [ ! -s "$TRACE" ]; then
+	echo "stress: FAIL no trace written"
+	exit 1
+fi
+
+# Event to screen spans, in microseconds
+grep '"name":"event to screen"' "$TRACE" | sed 's/.*"dur":\([0-9.]*\).*/\1/' | sort -n > "$DIR/events"
+events=$(wc -l < "$DIR/events")
+late=$(awk -v late="$LATE_MS" '$1 > late * 1000' "$DIR/events" | wc -l)
+[ "$events" -gt 0 ] && awk -v late="$LATE_MS" -v n_late="$late" '
+	function at(q,  i) { i = int(NR * q); if (i < NR * q) i++; return d[i < 1 ? 1 : i] / 1000 }
+	{ d[NR] = $1 }
+	END {
+		printf "events: %d on screen, p50 %.2f ms, p99 %.2f ms, max %.2f ms, %d over %d ms\n",
+			NR, at(0.5), at(0.99), d[NR] / 1000, n_late, late
+	}' "$DIR/events"
+if [ "$events" -eq 0 ]; then
+	echo "stress: FAIL no event reached screen"
+	fail=1
+elif [ "$late" -gt "$MAX_LATE" ]; then
+	echo "stress: FAIL $late late updates, limit $MAX_LATE"
+	fail=1
+fi
+
+# Server lists as "port" and "port -> peer" lines, sorted
+lsp_lines() {
+	awk '/^ / { sub(/^ +/, ""); print port " -> " $0; next } { port = $0; print }' "$1" | sort
+}
+if [ ! -f "$LSP.before" ] || [ ! -f "$LSP.after" ]; then
+	echo "stress: FAIL server was not listed before and after churn"
+	fail=1
+else
+	lsp_lines "$LSP.before" > "$DIR/before"
+	lsp_lines "$LSP.after" > "$DIR/after"
+	echo "server: $(grep -vc ' -> ' "$DIR/before") ports, $(( $(grep -c ' -> ' "$DIR/before") / 2 )) connections before churn"
+	if ! cmp -s "$DIR/before" "$DIR/after"; then
+		echo "stress: FAIL server lists differ before and after churn"
+		diff "$DIR/before" "$DIR/after" | head -10
+		fail=1
+	fi
+fi
+
+# Graph shown first and last, by names of its ports and connections
+mark() {
+	grep "\"name\":\"$1\"" "$TRACE" | sed 's/.*"arg":\([0-9]*\).*/\1/' | sed -n "$2"
+}
+generations=$(grep -c '"name":"graph"' "$TRACE")
+echo "graph: ports/connections $(mark ports 1p)/$(mark connections 1p) at start," \
+	"$(mark ports '$p')/$(mark connections '$p') at end, $generations generations shown"
+if [ "$(mark graph 1p)" != "$(mark graph '$p')" ]; then
+	echo "stress: FAIL lost updates, graph shown at end differs from start"
+	fail=1
+fi
+
+# Memory halfway through churn against after it: first half brings
+# arenas and buffers to working size, leaks keep growing in second
+rss() {
+	awk -v s="$1" '$1 == s { print $NF }' "$OUT"
+}
+growth=$(( $(rss settle) - $(rss churn) ))
+echo "memory: rss $(rss warm) kB after warm up, $(rss churn) kB halfway, $(rss settle) kB after churn, growth $growth kB"
+if [ $growth -gt "$MAX_GROWTH_KB" ]; then
+	echo "stress: FAIL memory grew $growth kB, limit $MAX_GROWTH_KB"
+	fail=1
+fi
+
+if [ $fail -eq 0 ]; then
+	echo "stress: passed"
+	rm -rf "$DIR"
+else
+	echo "stress: files kept in $DIR"
+fi
+exit $fail
@@ -1,6 +1,8 @@
+#include <stdlib.h>
 #include <string.h>
 
 #include "window.h"
+#include "port_connection.h"
 
 void w_create(Window* W, int height, int width, int starty, int startx, const char* name, enum WinType type) {
 	W->window_ptr = newwin(height, width, starty, startx);
@@ -8,9 +10,28 @@ void w_create(Window* W, int height, int width, int starty, int startx, const ch
 	W->width = width;
 	W->height = height;
 	W->name = name;
+	W->items = NULL;
+	W->item_size = 0;
 	W->index = 0;
+	W->count = 0;
 	W->type = type;
 	W->redraw = true;
+	W->sel.bits = NULL;
+	W->sel.size = 0;
+	W->sel.capacity = 0;
+	W->sel_anchor = 0;
+	W->sel_keys = NULL;
+	W->sel_key_count = 0;
+	W->sel_key_capacity = 0;
+	W->keys_saved = false;
+	W->run_start = NULL;
+	W->run_next = NULL;
+	W->run_capacity = 0;
+	W->blank = NULL;
+	W->tagged = false;
+	W->metered = false;
+	W->latency = false;
+	w_layout(W);
 	//  scrollok(w->window_ptr, true);
 }
 
@@ -18,10 +39,22 @@ void w_cleanup(Window* windows) {
 	short i;
 	Window* w = windows;
 
+	/* Views point into model which is going away */
 	for (i = 0; i < 3; i++, w++) {
-		JSList* l = w->list;
-		jack_slist_free(l);
+		w->items = NULL;
+		w->count = 0;
 		w->redraw = true;
+		bitset_free(&w->sel);
+		free(w->sel_keys);
+		w->sel_keys = NULL;
+		w->sel_key_count = w->sel_key_capacity = 0;
+		w->keys_saved = false;
+		free(w->run_start);
+		free(w->run_next);
+		free(w->blank);
+		w->run_start = w->run_next = NULL;
+		w->run_capacity = 0;
+		w->blank = NULL;
 	}
 }
 
@@ -41,15 +74,67 @@ void w_draw_border(Window* W) {
 	}
 }
 
-void w_assign_list(Window* W, JSList* list) {
-	W->list = list;
-	W->count = jack_slist_length(W->list);
+/* Client used for grouping items */
+unsigned int w_item_client(Window* W, void* data) {
+	switch ( W->type ) {
+		case WIN_PORTS:
+			return ((Port*) data)->client;
+		case WIN_CONNECTIONS:
+			return ((Connection*) data)->out->client;
+	}
+	return 0;
+}
+
+/* Find runs of adjacent items with same client, so client jumps are O(1) */
+static void w_build_runs(Window* W) {
+	if (W->count + 1 > W->run_capacity) {
+		W->run_capacity = 2 * W->count + 1;
+		W->run_start = realloc(W->run_start, W->run_capacity * sizeof(unsigned int));
+		W->run_next = realloc(W->run_next, W->run_capacity * sizeof(unsigned int));
+	}
+
+	unsigned int i, first = 0, prev = 0;
+	for ( i=0; i < W->count; i++ ) {
+		unsigned int client = w_item_client(W, w_get_item(W, i));
+		if ( i == 0 || client != prev ) {
+			unsigned int j;
+			for (j = first; j < i; j++)
+				W->run_next[j] = i;
+			first = i;
+			prev = client;
+		}
+		W->run_start[i] = first;
+	}
+	for (; first < i; first++)
+		W->run_next[first] = i;
+}
+
+/* Positions mean nothing in another list, selection is dropped here
+ * and carried over by identity with w_sel_save / w_sel_restore */
+void w_assign_list(Window* W, void* items, unsigned int count, size_t item_size) {
+	W->items = items;
+	W->item_size = item_size;
+	W->count = count;
 	W->redraw = true;
 
-	if (W->index > W->count - 1)
+	bitset_resize(&W->sel, W->count);
+	W->sel_anchor = 0;
+	w_build_runs(W);
+
+	if (W->index >= W->count)
 		W->index = 0;
 }
 
+/* Same items in another list, positions and selection stay */
+void w_move_list(Window* W, void* items) {
+	W->items = items;
+}
+
+void* w_get_item(Window* W, unsigned int pos) {
+	if (pos >= W->count || ! W->items) return NULL;
+	return (char*) W->items + pos * W->item_size;
+}
+
 void w_resize(Window* W, int height, int width, int starty, int startx) {
 	//delwin(W->window_ptr);
 	//W->window_ptr = newwin(height, width, starty, startx);
@@ -58,10 +143,32 @@ void w_resize(Window* W, int height, int width, int starty, int startx) {
 	W->width = width;
 	W->height = height;
 	W->redraw = true;
+	w_layout(W);
+}
+
+/* Compute name columns once, rows are drawn without format parsing */
+void w_layout(Window* W) {
+	int width = W->tagged ? W->width - W_TAG_WIDTH : W->width;
+	if ( W->metered ) width -= W_METER_WIDTH;
+	if ( W->latency ) width -= W_LAT_WIDTH;
+
+	switch ( W->type ) {
+		case WIN_PORTS:
+			W->name_width = width - 2;
+			break;
+		case WIN_CONNECTIONS: /* "out -> in" */
+			W->name_width = width / 2 - 3;
+			break;
+	}
+	if (W->name_width < 0) W->name_width = 0;
+
+	W->blank = realloc(W->blank, W->name_width + 1);
+	memset(W->blank, ' ', W->name_width);
+	W->blank[W->name_width] = '\0';
 }
 
 void w_item_next(Window* W) {
-	if (W->index < W->count - 1)
+	if (W->index + 1 < W->count)
 		W->index++;
 }
 
@@ -69,3 +176,158 @@ void w_item_previous(Window* W) {
 	if (W->index > 0)
 		W->index--;
 }
+
+void w_item_last(Window* W) {
+	W->index = W->count ? W->count - 1 : 0;
+}
+
+void w_item_move(Window* W, int delta) {
+	long index = (long) W->index + delta;
+	if (index > (long) W->count - 1) index = (long) W->count - 1;
+	if (index < 0) index = 0;
+	W->index = index;
+}
+
+void w_item_next_client(Window* W) {
+	if (W->index >= W->count) return;
+	if (W->run_next[W->index] < W->count)
+		W->index = W->run_next[W->index];
+}
+
+void w_item_previous_client(Window* W) {
+	if (W->index >= W->count) return;
+	if (W->run_start[W->index] != W->index)
+		W->index = W->run_start[W->index];
+	else if (W->index > 0)
+		W->index = W->run_start[W->index - 1];
+}
+
+bool w_is_selected(Window* W, unsigned int pos) {
+	return bitset_get(&W->sel, pos);
+}
+
+void w_sel_toggle(Window* W) {
+	bitset_toggle(&W->sel, W->index);
+	W->sel_anchor = W->index;
+	W->redraw = true;
+}
+
+/* Select everything between last toggled item and current one */
+void w_sel_range(Window* W) {
+	unsigned int i = W->sel_anchor, last = W->index;
+	if (i > last) {
+		i = W->index;
+		last = W->sel_anchor;
+	}
+
+	for (; i <= last; i++)
+		bitset_set(&W->sel, i, true);
+	W->redraw = true;
+}
+
+/* Select client run of current item, as client jumps see it */
+void w_sel_run(Window* W) {
+	if (W->index >= W->count) return;
+
+	unsigned int i;
+	for (i = W->run_start[W->index]; i < W->run_next[W->index]; i++)
+		bitset_set(&W->sel, i, true);
+	W->redraw = true;
+}
+
+void w_sel_clear(Window* W) {
+	bitset_clear_all(&W->sel);
+	W->redraw = true;
+}
+
+unsigned int w_sel_count(Window* W) {
+	return bitset_count(&W->sel);
+}
+
+static ItemKey w_item_key(Window* W, unsigned int pos) {
+	ItemKey k = { 0, 0 };
+	void* data = w_get_item(W, pos);
+
+	if (! data) return k;
+	switch ( W->type ) {
+		case WIN_PORTS:
+			k.a = ((Port*) data)->uuid;
+			break;
+		case WIN_CONNECTIONS:
+			k.a = ((Connection*) data)->out->uuid;
+			k.b = ((Connection*) data)->in->uuid;
+			break;
+	}
+	return k;
+}
+
+static int w_key_cmp(const void* a, const void* b) {
+	const ItemKey* x = a;
+	const ItemKey* y = b;
+
+	if (x->a != y->a) return x->a < y->a ? -1 : 1;
+	if (x->b != y->b) return x->b < y->b ? -1 : 1;
+	return 0;
+}
+
+/* Remember selection, cursor and anchor by identity, while list
+ * still points into the old generation */
+void w_sel_save(Window* W) {
+	unsigned int pos, n = w_sel_count(W);
+
+	if (n > W->sel_key_capacity) {
+		W->sel_key_capacity = 2 * n;
+		W->sel_keys = realloc(W->sel_keys, W->sel_key_capacity * sizeof(ItemKey));
+	}
+	W->sel_key_count = 0;
+	for ( pos=0; n && pos < W->count; pos++ ) {
+		if ( bitset_get(&W->sel, pos) )
+			W->sel_keys[W->sel_key_count++] = w_item_key(W, pos);
+	}
+	qsort(W->sel_keys, W->sel_key_count, sizeof(ItemKey), w_key_cmp);
+
+	W->index_key = w_item_key(W, W->index);
+	W->anchor_key = w_item_key(W, W->sel_anchor);
+	W->keys_saved = true;
+}
+
+/* Find saved items in new list. Returns number of selected items
+ * which are gone */
+unsigned int w_sel_restore(Window* W) {
+	unsigned int pos, found = 0;
+	ItemKey k;
+
+	if (! W->keys_saved) return 0;
+	W->keys_saved = false;
+	if (W->index_key.a == 0 && W->sel_key_count == 0) return 0;
+
+	for ( pos=0; pos < W->count; pos++ ) {
+		k = w_item_key(W, pos);
+		if ( W->sel_key_count &&
+		     bsearch(&k, W->sel_keys, W->sel_key_count, sizeof(ItemKey), w_key_cmp) ) {
+			bitset_set(&W->sel, pos, true);
+			found++;
+		}
+		if ( w_key_cmp(&k, &W->index_key) == 0 )
+			W->index = pos;
+		if ( w_key_cmp(&k, &W->anchor_key) == 0 )
+			W->sel_anchor = pos;
+	}
+	return W->sel_key_count - found;
+}
+
+/* Fill items with selected list data, or current item if nothing selected */
+unsigned int w_sel_collect(Window* W, void** items) {
+	unsigned int pos, n = 0;
+
+	if ( w_sel_count(W) == 0 ) {
+		items[0] = w_get_item(W, W->index);
+		return items[0] ? 1 : 0;
+	}
+
+	for ( pos=0; pos < W->count; pos++ ) {
+		if ( bitset_get(&W->sel, pos) )
+			items[n++] = w_get_item(W, pos);
+	}
+	return n;
+}
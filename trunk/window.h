@@ -2,32 +2,80 @@
 #define WINDOW_H
 
 #include <ncurses.h>
-#include <jack/jslist.h>
+#include <stdint.h>
+
+#include "bitset.h"
+
+#define W_TAG_WIDTH 2 /* type marker and space */
+#define W_METER_BAR 10
+#define W_METER_WIDTH (W_METER_BAR + 3) /* " [" bar "]" */
+#define W_LAT_WIDTH 12 /* " port/path" in frames */
 
 enum WinType {
 	WIN_PORTS,
 	WIN_CONNECTIONS
 };
 
+/* Item identity which holds across generations: port id,
+ * or ids of both ends of connection */
+typedef struct {
+	uint64_t a;
+	uint64_t b;
+} ItemKey;
+
 typedef struct {
 	WINDOW* window_ptr;
-	JSList* list;
+	void* items; /* view: slice of model table */
+	size_t item_size;
 	bool selected;
 	bool redraw;
 	int height;
 	int width;
 	const char * name;
-	unsigned short index;
-	unsigned short count;
+	unsigned int index;
+	unsigned int count;
 	enum WinType type;
+	Bitset sel; /* user selection, parallel to list */
+	unsigned int sel_anchor;
+	ItemKey* sel_keys; /* selection saved over generation switch */
+	unsigned int sel_key_count;
+	unsigned int sel_key_capacity;
+	ItemKey index_key;
+	ItemKey anchor_key;
+	bool keys_saved;
+	unsigned int* run_start; /* first item of same client run */
+	unsigned int* run_next;  /* first item of next client run */
+	unsigned int run_capacity; /* run tables only grow */
+	bool tagged;    /* rows start with type marker */
+	bool metered;   /* rows end with level meter */
+	bool latency;   /* rows end with latency numbers */
+	int name_width; /* layout: room for one name, recomputed on resize */
+	char* blank;    /* name_width spaces for padding */
 } Window;
 
 void w_create(Window* W, int height, int width, int starty, int startx, const char* name, enum WinType type);
 void w_cleanup(Window* windows);
 void w_draw_border(Window* W);
-void w_assign_list(Window* W, JSList* list);
+void w_assign_list(Window* W, void* items, unsigned int count, size_t item_size);
+void w_move_list(Window* W, void* items);
+void* w_get_item(Window* W, unsigned int pos);
 void w_resize(Window* W, int height, int width, int starty, int startx);
+void w_layout(Window* W);
 void w_item_next(Window* W);
 void w_item_previous(Window* W);
+void w_item_last(Window* W);
+void w_item_move(Window* W, int delta);
+void w_item_next_client(Window* W);
+void w_item_previous_client(Window* W);
+unsigned int w_item_client(Window* W, void* data);
+bool w_is_selected(Window* W, unsigned int pos);
+void w_sel_toggle(Window* W);
+void w_sel_range(Window* W);
+void w_sel_run(Window* W);
+void w_sel_clear(Window* W);
+unsigned int w_sel_count(Window* W);
+unsigned int w_sel_collect(Window* W, void** items);
+void w_sel_save(Window* W);
+unsigned int w_sel_restore(Window* W);
 
 #endif /* WINDOW_H */